@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Tokenization results, overscan statistics are collected only if requested
+struct TokenizeStats {
+    std::uint64_t token_count = 0;
+    std::uint64_t checksum = 0;               // Must be the same for all engine variants of the same spec
+    std::uint64_t unrolled_token_count = 0;   // Tokens, for which the engine scanned past the lexeme end
+    std::uint64_t overscan_symbol_count = 0;  // Symbols scanned past lexeme ends and then rolled back
+};
+
+// Engine generated from `spec` with option set `variant`
+struct BenchEngine {
+    std::string_view spec;
+    std::string_view variant;
+    TokenizeStats (*tokenize)(std::string_view text, bool count_overscan);
+};
+
+bool registerBenchEngine(const BenchEngine& engine);
+
+// Deterministic synthetic text for `spec`, a text-heavy corpus consists mostly of long comments and strings
+std::string makeCorpus(std::string_view spec, std::size_t size, bool text_heavy);
+
+// Deterministic spec of `count` random [a-d] literals of `length` symbols and `[a-d]+`, its DFA has about
+// `count * length` states with long distinguishing suffixes, so it stresses DFA construction and minimization
+std::string makeLiteralSpec(unsigned count, unsigned length);
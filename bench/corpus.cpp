@@ -0,0 +1,219 @@
+#include "bench.h"
+
+#include <array>
+#include <random>
+
+namespace {
+// `std::minstd_rand` output is fully specified by the standard, so corpora are the same on all platforms
+class TextGenerator {
+ public:
+    explicit TextGenerator(std::string& text) : text_(text) {}
+
+    unsigned random(unsigned n) { return static_cast<unsigned>(rng_() % n); }
+    bool chance(unsigned percent) { return random(100) < percent; }
+    template<std::size_t N>
+    std::string_view pick(const std::array<std::string_view, N>& items) {
+        return items[random(static_cast<unsigned>(N))];
+    }
+
+    TextGenerator& put(std::string_view s) {
+        text_ += s;
+        return *this;
+    }
+    TextGenerator& put(char ch) {
+        text_ += ch;
+        return *this;
+    }
+    TextGenerator& putNumber(unsigned max) { return put(std::to_string(random(max))); }
+    TextGenerator& putDigits(unsigned count) {
+        while (count--) { text_ += static_cast<char>('0' + random(10)); }
+        return *this;
+    }
+    TextGenerator& putHex(unsigned count) {
+        while (count--) { text_ += "0123456789abcdef"[random(16)]; }
+        return *this;
+    }
+    TextGenerator& putId(unsigned max_len = 12) {
+        text_ += "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ"[random(53)];
+        for (unsigned len = random(max_len); len > 0; --len) {
+            text_ += "abcdefghijklmnopqrstuvwxyz_0123456789"[random(37)];
+        }
+        return *this;
+    }
+    TextGenerator& putWords(unsigned max_count) {
+        for (unsigned count = 1 + random(max_count); count > 0; --count) { putId(8).put(' '); }
+        return *this;
+    }
+
+ private:
+    std::string& text_;
+    std::minstd_rand rng_;
+};
+
+void makeCText(TextGenerator& gen) {
+    static const std::array<std::string_view, 10> types{"int",  "unsigned", "char",  "long",        "double",
+                                                        "void", "short",    "float", "const char*", "size_t"};
+    static const std::array<std::string_view, 14> ops{" = ",  " + ",  " - ",  " * ",  " / ",  " == ", " != ",
+                                                      " <= ", " >= ", " && ", " || ", " << ", " += ", "->"};
+    switch (gen.random(10)) {
+        case 0: gen.put("#include <").putId(8).put(".h>\n"); break;
+        case 1: gen.put("/* ").putWords(10).put("*/\n"); break;
+        case 2: gen.put("    // ").putWords(8).put('\n'); break;
+        case 3: {
+            gen.put("    if (").putId().put(gen.pick(ops)).putNumber(1000);
+            gen.put(") { return ").putId().put("; }\n");
+        } break;
+        case 4: {
+            gen.put("    for (int i = 0; i < ").putId().put("; ++i) { ");
+            gen.putId().put("[i] = 0x").putHex(4).put("; }\n");
+        } break;
+        case 5: gen.put("    printf(\"").putWords(4).put("%d\\n\", ").putId().put(");\n"); break;
+        case 6: {
+            gen.put(gen.pick(types)).put(' ').putId().put('(');
+            gen.put(gen.pick(types)).put(' ').putId().put(") {\n");
+        } break;
+        case 7: {
+            gen.put("    ").putId().put(gen.pick(ops));
+            gen.putDigits(2).put('.').putDigits(3).put("e-").putDigits(1).put(";\n");
+        } break;
+        case 8: {
+            gen.put("    ").put(gen.pick(types)).put(' ').putId();
+            gen.put(" = '").put(gen.chance(50) ? "\\n" : "x").put("';\n");
+        } break;
+        default: gen.put("    return ").putId().put(gen.pick(ops)).putId().put(";\n}\n\n"); break;
+    }
+}
+
+void makeJsonValue(TextGenerator& gen, unsigned depth) {
+    switch (depth < 4 ? gen.random(8) : 2 + gen.random(6)) {
+        case 0: {
+            gen.put("{\n");
+            for (unsigned count = 1 + gen.random(6); count > 0; --count) {
+                gen.put(std::string(2 * depth + 2, ' ')).put('"').putId(10).put("\": ");
+                makeJsonValue(gen, depth + 1);
+                if (count > 1) { gen.put(','); }
+                gen.put('\n');
+            }
+            gen.put(std::string(2 * depth, ' ')).put('}');
+        } break;
+        case 1: {
+            gen.put('[');
+            for (unsigned count = 1 + gen.random(5); count > 0; --count) {
+                makeJsonValue(gen, depth + 1);
+                if (count > 1) { gen.put(", "); }
+            }
+            gen.put(']');
+        } break;
+        case 2: gen.put('"').putWords(4).put(gen.chance(20) ? "\\u00e9\\n" : "").put('"'); break;
+        case 3: gen.put(gen.chance(30) ? "-" : "").putNumber(100000); break;
+        case 4: gen.putNumber(1000).put('.').putDigits(4).put(gen.chance(20) ? "e+10" : ""); break;
+        case 5: gen.put(gen.chance(50) ? "true" : "false"); break;
+        case 6: gen.put("null"); break;
+        default: gen.put('"').putId(16).put('"'); break;
+    }
+}
+
+void makeJsonLine(TextGenerator& gen) {
+    makeJsonValue(gen, 0);
+    gen.put('\n');
+}
+
+void makeLogLine(TextGenerator& gen) {
+    static const std::array<std::string_view, 6> levels{"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+    gen.put("2024-").putDigits(2).put('-').putDigits(2).put('T').putDigits(2).put(':').putDigits(2).put(':');
+    gen.putDigits(2).put('.').putDigits(3).put("Z ").put(gen.pick(levels)).put(" [worker-").putNumber(16).put("] ");
+    gen.putWords(4);
+    for (unsigned count = gen.random(5); count > 0; --count) {
+        gen.putId(8).put('=');
+        switch (gen.random(6)) {
+            case 0: gen.putNumber(1000).put(gen.chance(50) ? "ms" : "us"); break;
+            case 1: gen.putNumber(256).put('.').putNumber(256).put('.').putNumber(256).put('.').putNumber(256); break;
+            case 2: gen.put("/api/v").putNumber(3).put('/').putId(8).put('/').putNumber(100000); break;
+            case 3: gen.putHex(8).put('-').putHex(4).put('-').putHex(4).put('-').putHex(4).put('-').putHex(12); break;
+            case 4: gen.put('"').putWords(3).put('"'); break;
+            default: gen.putNumber(100000); break;
+        }
+        gen.put(' ');
+    }
+    gen.put('\n');
+}
+
+void makeLexSpecLine(TextGenerator& gen) {
+    switch (gen.random(6)) {
+        case 0: gen.put("%start ").putId(8).put('\n'); break;
+        case 1: gen.put("# ").putWords(8).put('\n'); break;
+        case 2: gen.putId(10).put("    [a-zA-Z_][a-zA-Z0-9_]*\n"); break;
+        case 3: gen.putId(10).put("    <").putId(6).put("> {").putId(6).put("}+(\\.{").putId(6).put("}*)?\n"); break;
+        case 4: gen.putId(10).put("    \"").putId(8).put("\"|\\x").putHex(2).put("{2,").putNumber(9).put("}\n"); break;
+        default: gen.put("%%\n"); break;
+    }
+}
+
+// Text-heavy corpora: most of the text is in long comments and strings, where run skipping matters most
+
+void makeCLongText(TextGenerator& gen) {
+    switch (gen.random(4)) {
+        case 0: gen.put("/* ").putWords(60).put('\n').putWords(60).put("*/\n"); break;
+        case 1: gen.put("    // ").putWords(40).put('\n'); break;
+        case 2: gen.put("    puts(\"").putWords(40).put("\");\n"); break;
+        default: makeCText(gen); break;
+    }
+}
+
+void makeJsonLongText(TextGenerator& gen) {
+    gen.put("{\n");
+    for (unsigned count = 1 + gen.random(4); count > 0; --count) {
+        gen.put("  \"").putId(10).put("\": \"").putWords(60).put('"');
+        if (count > 1) { gen.put(','); }
+        gen.put('\n');
+    }
+    gen.put("}\n");
+}
+
+void makeLogLongText(TextGenerator& gen) {
+    gen.put("2024-").putDigits(2).put('-').putDigits(2).put('T').putDigits(2).put(':').putDigits(2).put(':');
+    gen.putDigits(2).put('.').putDigits(3).put("Z INFO [worker-").putNumber(16).put("] message=\"").putWords(60);
+    gen.put("\"\n");
+}
+
+void makeLexSpecLongText(TextGenerator& gen) {
+    if (gen.chance(70)) {
+        gen.put("# ").putWords(40).put('\n');
+    } else {
+        makeLexSpecLine(gen);
+    }
+}
+}  // namespace
+
+std::string makeCorpus(std::string_view spec, std::size_t size, bool text_heavy) {
+    void (*make_item)(TextGenerator&) = nullptr;
+    if (spec == "c") {
+        make_item = text_heavy ? makeCLongText : makeCText;
+    } else if (spec == "json") {
+        make_item = text_heavy ? makeJsonLongText : makeJsonLine;
+    } else if (spec == "log") {
+        make_item = text_heavy ? makeLogLongText : makeLogLine;
+    } else {
+        make_item = text_heavy ? makeLexSpecLongText : makeLexSpecLine;
+    }
+
+    std::string text;
+    text.reserve(size + 1024);
+    TextGenerator gen(text);
+    while (text.size() < size) { make_item(gen); }
+    return text;
+}
+
+std::string makeLiteralSpec(unsigned count, unsigned length) {
+    std::string spec;
+    TextGenerator gen(spec);
+    gen.put("# ").put(std::to_string(count)).put(" random literals of length ").put(std::to_string(length));
+    gen.put("\n\n%%\n\n");
+    for (unsigned n = 0; n < count; ++n) {
+        gen.put("lit").put(std::to_string(n)).put(" \"");
+        for (unsigned len = length; len > 0; --len) { gen.put("abcd"[gen.random(4)]); }
+        gen.put("\"\n");
+    }
+    gen.put("word [a-d]+\nother .\n\n%%\n");
+    return spec;
+}
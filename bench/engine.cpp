@@ -0,0 +1,192 @@
+// Compiled once per generated analyzer: `lex_defs.h` and `lex_analyzer.inl` are taken from the include directory of
+// the engine variant, `BENCH_SPEC` and `BENCH_VARIANT` name it, `BENCH_BATCH` is defined if `lex_batch()` is generated,
+// `BENCH_TEMPLATE` is defined if `lex_traits` for `lexegen::engine` template are generated instead of `lex()`,
+// `BENCH_IMAGE_FILE` is the DFA image path if the image is analyzed by `lexegen::dfa_image` runtime instead of `lex()`,
+// `BENCH_SCANNER` is defined if the text is tokenized by `lexegen::scanner` reading it in chunks, `BENCH_STACKLESS` is
+// defined if the analyzer is generated with `--stackless` option, `BENCH_PARALLEL` is defined if the text is tokenized
+// by `lexegen::lex_parallel()` in all hardware threads
+
+#include "bench.h"
+
+// Vectorized run skipping (`--skip-runs`) uses the widest instruction set enabled for the compiler
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define LEX_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#    define LEX_USE_SSE2
+#endif
+
+#if defined(BENCH_TEMPLATE)
+#    include "lexegen/engine.h"
+#elif defined(BENCH_IMAGE_FILE)
+#    include "lexegen/image.h"
+#endif
+
+#if defined(BENCH_SCANNER)
+#    include "lexegen/scanner.h"
+#elif defined(BENCH_PARALLEL)
+#    include "lexegen/parallel.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+namespace lex_detail {
+#include "lex_defs.h"
+#if defined(BENCH_IMAGE_FILE)
+const lexegen::mapped_dfa_image g_image(BENCH_IMAGE_FILE);
+int lex(const char* first, const char* last, int** p_sptr, std::size_t* p_llen, int flags) {
+    return g_image.lex(first, last, p_sptr, p_llen, flags);
+}
+#else
+#    include "lex_analyzer.inl"
+#    if defined(BENCH_TEMPLATE)
+constexpr auto lex = &lexegen::engine<lex_traits>::lex<char>;
+#    endif
+#endif
+}  // namespace lex_detail
+
+template<typename Ty>
+Ty getStateType(int (*)(const char*, const char*, Ty**, std::size_t*, int));
+using State = decltype(getStateType(lex_detail::lex));
+
+const std::size_t kInitialStackSize = 256;
+
+template<bool CountOverscan>
+TokenizeStats tokenize(std::string_view text) {
+    TokenizeStats stats;
+
+    // Unused stack cells are kept negative, so after each `lex()` call visited states can be counted
+    std::vector<State> state_stack(kInitialStackSize, -1);
+    State* sptr = state_stack.data();
+    *sptr++ = lex_detail::sc_initial;
+
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    while (first != last) {
+        const char* lexeme_first = first;
+        int flags = lexeme_first == text.data() || *(lexeme_first - 1) == '\n' ? lex_detail::flag_at_beg_of_line : 0;
+        std::size_t llen = 0;
+        int pat = 0;
+        while (true) {
+            const char* trimmed_last = last;
+            const State* slast = state_stack.data() + state_stack.size();
+            if (slast - sptr < last - first) { trimmed_last = first + static_cast<std::ptrdiff_t>(slast - sptr); }
+            pat = lex_detail::lex(first, trimmed_last, &sptr, &llen,
+                                  flags | (trimmed_last != last ? lex_detail::flag_has_more : 0));
+            if (pat >= lex_detail::predef_pat_default) { break; }  // Full lexeme is obtained
+            const std::ptrdiff_t depth = sptr - state_stack.data();
+            state_stack.resize(2 * state_stack.size(), -1);
+            sptr = state_stack.data() + depth;
+            first = trimmed_last;
+        }
+
+        if constexpr (CountOverscan) {
+            State* p = sptr;
+            for (; p != state_stack.data() + state_stack.size() && *p >= 0; ++p) { *p = -1; }
+            const auto scanned = static_cast<std::size_t>(p - sptr);
+            if (scanned > llen) { ++stats.unrolled_token_count, stats.overscan_symbol_count += scanned - llen; }
+        }
+
+        ++stats.token_count;
+        stats.checksum = 31 * stats.checksum + static_cast<unsigned>(pat) * 1024 + llen;
+        first = lexeme_first + llen;
+    }
+    return stats;
+}
+
+#if defined(BENCH_BATCH)
+TokenizeStats tokenizeBatch(std::string_view text) {
+    const std::size_t kBatchSize = 256;
+    TokenizeStats stats;
+
+    int pats[kBatchSize];
+    std::size_t offsets[kBatchSize], lengths[kBatchSize];
+    std::vector<State> state_stack(kInitialStackSize);
+    State* sptr = state_stack.data();
+    *sptr++ = lex_detail::sc_initial;
+
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    std::size_t llen = 0, offset = 0;
+    while (true) {
+        int flags = first == text.data() || *(first - 1) == '\n' ? lex_detail::flag_at_beg_of_line : 0;
+        const std::size_t count = lex_detail::lex_batch(text.data(), &first, last, &sptr,
+                                                        state_stack.data() + state_stack.size(), &llen, flags, pats,
+                                                        offsets, lengths, kBatchSize);
+        for (std::size_t n = 0; n < count; ++n) {
+            if (offsets[n] != offset) { return {}; }  // Lexemes must follow each other
+            offset += lengths[n];
+            stats.checksum = 31 * stats.checksum + static_cast<unsigned>(pats[n]) * 1024 + lengths[n];
+        }
+        stats.token_count += count;
+        if (count == kBatchSize) { continue; }
+        if (first == last) { break; }
+        const std::ptrdiff_t depth = sptr - state_stack.data();  // State stack is full
+        state_stack.resize(2 * state_stack.size());
+        sptr = state_stack.data() + depth;
+    }
+    return stats;
+}
+
+TokenizeStats tokenizeText(std::string_view text, bool /*count_overscan*/) { return tokenizeBatch(text); }
+#elif defined(BENCH_SCANNER)
+TokenizeStats tokenizeScanner(std::string_view text) {
+    const std::size_t kChunkSize = 4096;  // Smaller than the window, so the window is refilled with partial lexemes
+    TokenizeStats stats;
+
+#    if defined(BENCH_STACKLESS)
+    const bool kStackless = true;
+#    else
+    const bool kStackless = false;
+#    endif
+
+    std::size_t pos = 0;
+    lexegen::scanner<State, kStackless> scanner(lex_detail::lex, [text, &pos](char* buf, std::size_t size) {
+        const std::size_t count = text.copy(buf, size < kChunkSize ? size : kChunkSize, pos);
+        pos += count;
+        return static_cast<std::ptrdiff_t>(count);
+    });
+
+    std::string_view lexeme;
+    int pat = 0;
+    while ((pat = scanner.next(lexeme)) != lexegen::err_end_of_input) {
+        ++stats.token_count;
+        stats.checksum = 31 * stats.checksum + static_cast<unsigned>(pat) * 1024 + lexeme.size();
+    }
+    return stats;
+}
+
+TokenizeStats tokenizeText(std::string_view text, bool /*count_overscan*/) { return tokenizeScanner(text); }
+#elif defined(BENCH_PARALLEL)
+TokenizeStats tokenizeParallel(std::string_view text) {
+    TokenizeStats stats;
+    const auto tokens = lexegen::lex_parallel<State>(lex_detail::lex, text);
+    std::size_t offset = 0;
+    for (const auto& t : tokens) {
+        if (t.offset != offset) { return {}; }  // Lexemes must follow each other
+        offset += t.length;
+        stats.checksum = 31 * stats.checksum + static_cast<unsigned>(t.pat) * 1024 + t.length;
+    }
+    stats.token_count = tokens.size();
+    return stats;
+}
+
+TokenizeStats tokenizeText(std::string_view text, bool /*count_overscan*/) { return tokenizeParallel(text); }
+#else
+TokenizeStats tokenizeText(std::string_view text, bool count_overscan) {
+    return count_overscan ? tokenize<true>(text) : tokenize<false>(text);
+}
+#endif
+
+#if defined(BENCH_IMAGE_FILE)
+// Note: the variant is skipped if the image can not be mapped
+const bool g_registered =
+    lex_detail::g_image.valid() && registerBenchEngine(BenchEngine{BENCH_SPEC, BENCH_VARIANT, tokenizeText});
+#else
+const bool g_registered = registerBenchEngine(BenchEngine{BENCH_SPEC, BENCH_VARIANT, tokenizeText});
+#endif
+}  // namespace
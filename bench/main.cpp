@@ -0,0 +1,108 @@
+#include "bench.h"
+
+#include <uxs/cli/parser.h>
+#include <uxs/format.h>
+#include <uxs/io/iobuf.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+
+namespace {
+std::vector<BenchEngine>& getEngines() {
+    static std::vector<BenchEngine> engines;
+    return engines;
+}
+}  // namespace
+
+bool registerBenchEngine(const BenchEngine& engine) {
+    getEngines().push_back(engine);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    bool show_help = false;
+    unsigned corpus_size_mb = 16;
+    unsigned repeat_count = 5;
+    std::string filter;
+    bool text_heavy = false;
+    unsigned literal_count = 0;
+    unsigned literal_length = 200;
+    auto cli = uxs::cli::command(argv[0])
+               << uxs::cli::overview("Throughput benchmark of analyzers generated by lexegen")
+               << (uxs::cli::option({"--size="}) & uxs::cli::value("<n>", corpus_size_mb)) %
+                      "Use synthetic corpora of <n> MiB, 16 MiB by default."
+               << (uxs::cli::option({"--repeat="}) & uxs::cli::value("<n>", repeat_count)) %
+                      "Run each engine <n> times and take the best time, 5 by default."
+               << (uxs::cli::option({"--filter="}) & uxs::cli::value("<str>", filter)) %
+                      "Run only engines, which `<spec>/<variant>` name contains <str>."
+               << uxs::cli::option({"--text-heavy"}).set(text_heavy) %
+                      "Use corpora of mostly long comments and strings instead of mixed code."
+               << (uxs::cli::option({"--literal-spec="}) & uxs::cli::value("<n>", literal_count)) %
+                      "Print spec of <n> random literals for generator scaling tests and exit."
+               << (uxs::cli::option({"--literal-length="}) & uxs::cli::value("<n>", literal_length)) %
+                      "Use literals of <n> symbols in `--literal-spec`, 200 by default."
+               << uxs::cli::option({"-h", "--help"}).set(show_help) % "Display this information.";
+
+    auto parse_result = cli->parse(argc, argv);
+    if (show_help) {
+        uxs::stdbuf::out().write(parse_result.node->get_command()->make_man_page(uxs::cli::text_coloring::colored));
+        return 0;
+    } else if (parse_result.status != uxs::cli::parsing_status::ok) {
+        uxs::println(uxs::stdbuf::log(), "invalid command line arguments, see `--help`");
+        return -1;
+    }
+
+    if (literal_count) {
+        uxs::stdbuf::out().write(makeLiteralSpec(literal_count, literal_length));
+        return 0;
+    }
+
+    auto& engines = getEngines();
+    std::sort(engines.begin(), engines.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.spec != rhs.spec ? lhs.spec < rhs.spec : lhs.variant < rhs.variant;
+    });
+
+    uxs::println(uxs::stdbuf::out(), "{:<24}{:>10}{:>12}{:>12}{:>16}{:>12}", "engine", "MB/s", "ns/token",
+                 "unroll, %", "overscan/token", "tokens");
+
+    std::map<std::string_view, std::string> corpora;
+    std::map<std::string_view, std::uint64_t> checksums;
+    int result = 0;
+    for (const auto& engine : engines) {
+        const std::string name = std::string(engine.spec) + '/' + std::string(engine.variant);
+        if (name.find(filter) == std::string::npos) { continue; }
+
+        auto& text = corpora[engine.spec];
+        if (text.empty()) {
+            text = makeCorpus(engine.spec, static_cast<std::size_t>(corpus_size_mb) << 20, text_heavy);
+        }
+
+        // Timed runs do not count overscan, the last run is separate and collects full statistics
+        double best_time = 0;
+        for (unsigned n = 0; n < std::max(repeat_count, 1u); ++n) {
+            const auto start = std::chrono::steady_clock::now();
+            const auto stats = engine.tokenize(text, false);
+            const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (n == 0 || time < best_time) { best_time = time; }
+            if (stats.token_count == 0) { return -1; }
+        }
+
+        const auto stats = engine.tokenize(text, true);
+        const auto [it, inserted] = checksums.emplace(engine.spec, stats.checksum);
+        if (!inserted && it->second != stats.checksum) {
+            uxs::println(uxs::stdbuf::log(), "{}: token stream differs from other variants", name);
+            result = -1;
+        }
+
+        const double tokens = static_cast<double>(stats.token_count);
+        uxs::println(uxs::stdbuf::out(), "{:<24}{:>10.1f}{:>12.2f}{:>12.2f}{:>16.3f}{:>12}", name,
+                     static_cast<double>(text.size()) / (1e6 * best_time), 1e9 * best_time / tokens,
+                     100. * static_cast<double>(stats.unrolled_token_count) / tokens,
+                     static_cast<double>(stats.overscan_symbol_count) / tokens, stats.token_count);
+    }
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Flags and predefined results of `lex()` shared by the runtime engines, the generated `lex_defs.h` defines the same
+// values for the C analyzer
+
+namespace lexegen {
+
+enum : int {
+    flag_has_more = 1,
+    flag_at_beg_of_line = 2,
+};
+
+enum : int {
+    err_end_of_input = -1,
+    predef_pat_default = 0,
+};
+
+}  // namespace lexegen
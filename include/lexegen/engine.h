@@ -0,0 +1,158 @@
+#pragma once
+
+// Header-only analyzer engine for tables generated with `--engine=template` option: the generated `lex_traits`
+// structure is passed as `Traits` parameter, so the compiler sees all tables and analyzer properties and can inline
+// `lex()` into the caller
+
+#include "defs.h"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace lexegen {
+
+// Bits of `flags` from `KnownFlags` mask are fixed to the values from `Flags` at compile time, the argument of `lex()`
+// is used only for the rest bits, e.g. `options<flag_has_more, 0>` removes suspension branches from the engine
+template<int KnownFlags = 0, int Flags = 0>
+struct options {
+    static constexpr int known_flags = KnownFlags;
+    static constexpr int flags = Flags & KnownFlags;
+};
+
+template<typename Traits, typename Options = options<>>
+class engine {
+ public:
+    using state_type = typename Traits::state_type;
+
+    // Has the same contract as the generated C function: analyzes [first, last) range, the state stack pointer and
+    // the matched lexeme length are updated, returns matched pattern or `err_end_of_input`; symbols of wider types
+    // are supported, but there are no transitions on symbols greater than 0xff
+    template<typename CharT>
+    static int lex(const CharT* first, const CharT* last, state_type** p_sptr, std::size_t* p_llen, int flags) {
+        if constexpr (Traits::stackless) {
+            return lexStackless(first, last, p_sptr, p_llen, flags);
+        } else {
+            state_type* sptr = *p_sptr;
+            state_type* sptr0 = sptr - *p_llen;
+            // Note: the start condition is on the top of the stack only if the analysis is not resumed
+            int state = *(sptr - 1);
+            if (!*p_llen) { state = getStartState(state, flags); }
+            while (first != last) {  // Analyze till transition is impossible
+                state = getNextState(state, *first);
+                if (state < 0) { break; }
+                *sptr++ = static_cast<state_type>(state), ++first;
+            }
+            if (first == last && (hasFlag<flag_has_more>(flags) || sptr == sptr0)) {
+                *p_sptr = sptr;
+                *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                return err_end_of_input;
+            }
+            *p_sptr = sptr0;
+            return unroll(sptr0, sptr, p_llen);
+        }
+    }
+
+ private:
+    template<int Flag>
+    static bool hasFlag(int flags) {
+        if constexpr ((Options::known_flags & Flag) != 0) {
+            return (Options::flags & Flag) != 0;
+        } else {
+            return (flags & Flag) != 0;
+        }
+    }
+
+    static int getStartState(int sc, int flags) {
+        if constexpr (Traits::has_left_nl_anchoring) {
+            return (sc << 1) + (hasFlag<flag_at_beg_of_line>(flags) ? 1 : 0);
+        } else {
+            return sc;
+        }
+    }
+
+    template<typename CharT>
+    static int getNextState(int state, CharT ch) {
+        const auto symb = static_cast<std::make_unsigned_t<CharT>>(ch);
+        if constexpr (sizeof(CharT) > 1) {
+            if (symb > 0xff) { return -1; }
+        }
+        if constexpr (Traits::compress_level == 0) {
+            return Traits::Dtran[256 * state + symb];
+        } else if constexpr (Traits::compress_level == 1) {
+            return Traits::Dtran[Traits::dtran_width * state + Traits::symb2meta[symb]];
+        } else {
+            const int meta = Traits::symb2meta[symb];
+            do {
+                const int l = Traits::base[state] + meta;
+                if (Traits::check[l] == state) { return Traits::next[l]; }
+                state = Traits::def[state];
+            } while (state >= 0);
+            return state;
+        }
+    }
+
+    static int unroll(const state_type* sptr0, const state_type* sptr, std::size_t* p_llen) {
+        while (sptr != sptr0) {  // Unroll down to last accepting state
+            int state = *(sptr - 1);
+            int n_pat = Traits::accept[state];
+            if (n_pat > 0) {
+                if constexpr (Traits::has_trailing_context) {
+                    enum { trailing_context_flag = 1, flag_count = 1 };
+                    if (!(n_pat & trailing_context_flag)) {
+                        *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                        return n_pat >> flag_count;
+                    }
+                    n_pat >>= flag_count;
+                    do {
+                        for (int i = Traits::lls_idx[state]; i < Traits::lls_idx[state + 1]; ++i) {
+                            if (Traits::lls_list[i] == n_pat) {
+                                *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                                return n_pat;
+                            }
+                        }
+                        state = *(--sptr - 1);
+                    } while (sptr != sptr0);
+                }
+                *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                return n_pat;
+            }
+            --sptr;
+        }
+        *p_llen = 1;  // Accept at least one symbol as default pattern
+        return predef_pat_default;
+    }
+
+    template<typename CharT>
+    static int lexStackless(const CharT* first, const CharT* last, state_type** p_sptr, std::size_t* p_llen,
+                            int flags) {
+        state_type* sptr = *p_sptr;
+        std::size_t llen = *p_llen, accept_len = 0;
+        int n_pat = 0, state = 0;
+        if (llen) {  // Resume analysis suspended at the end of input buffer
+            state = *--sptr, accept_len = static_cast<std::size_t>(*--sptr), n_pat = *--sptr;
+        } else {
+            state = getStartState(*(sptr - 1), flags);
+        }
+        while (first != last) {  // Analyze till transition is impossible
+            state = getNextState(state, *first);
+            if (state < 0) { break; }
+            ++first, ++llen;
+            if (Traits::accept[state] > 0) { n_pat = Traits::accept[state], accept_len = llen; }
+        }
+        if (first == last && (hasFlag<flag_has_more>(flags) || !llen)) {
+            if (llen) { *sptr++ = n_pat, *sptr++ = static_cast<state_type>(accept_len), *sptr++ = state; }
+            *p_sptr = sptr;
+            *p_llen = llen;
+            return err_end_of_input;
+        }
+        *p_sptr = sptr;
+        if (n_pat > 0) {  // Return last accepting state
+            *p_llen = accept_len;
+            return n_pat;
+        }
+        *p_llen = 1;  // Accept at least one symbol as default pattern
+        return predef_pat_default;
+    }
+};
+
+}  // namespace lexegen
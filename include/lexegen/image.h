@@ -0,0 +1,101 @@
+#pragma once
+
+// DFA image written by `lexegen --emit-binary`: a header followed by the tables, which are referenced by offsets from
+// the image beginning, so the image is position-independent and can be used in place right after it is mapped
+
+#include "defs.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lexegen {
+
+enum : std::uint32_t {
+    image_magic = 0x4746584c,  // "LXFG" in little-endian byte order, so images of other byte order are rejected
+    image_version = 1,
+    image_alignment = 64,  // Each table starts on a cache line
+};
+
+enum : std::uint32_t {
+    image_flag_has_trailing_context = 1,
+    image_flag_has_left_nl_anchoring = 2,
+};
+
+// All tables except `symb2meta` consist of `int32_t` values and have the same meaning as the compressed tables of
+// the generated C analyzer (`--compress 2`)
+struct image_header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t image_size;
+    std::uint32_t flags;
+    std::uint32_t state_count;       // `def`, `base` and `accept` sizes, `lls_idx` has one more item
+    std::uint32_t transition_count;  // `next` and `check` sizes
+    std::uint32_t lls_list_size;
+    std::uint32_t symb2meta_offset;  // 256 `uint8_t` values
+    std::uint32_t def_offset;
+    std::uint32_t base_offset;
+    std::uint32_t next_offset;
+    std::uint32_t check_offset;
+    std::uint32_t accept_offset;
+    std::uint32_t lls_idx_offset;  // LLS tables are present only with `image_flag_has_trailing_context`
+    std::uint32_t lls_list_offset;
+};
+
+// Tables of an image placed in memory: the data are not copied and must outlive the object
+class dfa_image {
+ public:
+    dfa_image() = default;
+    dfa_image(const void* data, std::size_t size) { attach(data, size); }
+
+    bool valid() const { return header_ != nullptr; }
+
+    // Checks the header, table bounds and all table values used as indices in one linear pass without allocation, so
+    // `lex()` can not read out of a corrupt image; the data must be 4-byte aligned
+    bool attach(const void* data, std::size_t size);
+    void detach() { header_ = nullptr; }
+
+    // Has the same contract as the generated C function with the `int` state stack
+    int lex(const char* first, const char* last, int** p_sptr, std::size_t* p_llen, int flags) const;
+
+ private:
+    const image_header* header_ = nullptr;
+    const std::uint8_t* symb2meta_ = nullptr;
+    const std::int32_t* def_ = nullptr;
+    const std::int32_t* base_ = nullptr;
+    const std::int32_t* next_ = nullptr;
+    const std::int32_t* check_ = nullptr;
+    const std::int32_t* accept_ = nullptr;
+    const std::int32_t* lls_idx_ = nullptr;
+    const std::int32_t* lls_list_ = nullptr;
+
+    int unroll(const int* sptr0, const int* sptr, std::size_t* p_llen) const;
+};
+
+// Image file mapped read-only into memory: its pages are shared between processes, and reopening the object with
+// another file swaps the analyzer
+class mapped_dfa_image : public dfa_image {
+ public:
+    mapped_dfa_image() = default;
+    explicit mapped_dfa_image(const char* file_name) { open(file_name); }
+
+    bool open(const char* file_name) {
+        detach();
+        if (!file_.open(file_name)) { return false; }
+        if (!attach(file_.data(), file_.size())) {
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        detach();
+        file_.close();
+    }
+
+ private:
+    mapped_file file_;
+};
+
+}  // namespace lexegen
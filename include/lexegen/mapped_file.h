@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lexegen {
+
+// File mapped read-only into memory, its pages are shared between processes; an empty file is opened with no data
+class mapped_file {
+ public:
+    mapped_file() = default;
+    explicit mapped_file(const char* file_name) { open(file_name); }
+    ~mapped_file() { close(); }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    bool is_open() const { return is_open_; }
+    const char* data() const { return static_cast<const char*>(data_); }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return {data(), size_}; }
+
+    bool open(const char* file_name);
+    void close();
+
+ private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool is_open_ = false;
+};
+
+}  // namespace lexegen
@@ -0,0 +1,150 @@
+#pragma once
+
+// Parallel tokenization of a large text: the text is split into chunks, each chunk is tokenized speculatively from its
+// beginning as if a lexeme started there, then chunks are stitched in order; a speculative lexeme boundary, which is
+// reached by the previous chunk, makes the rest of the chunk valid, because the lexeme at a given position does not
+// depend on preceding lexemes, so the result is the same as of sequential tokenization
+
+#include "defs.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace lexegen {
+
+struct token {
+    std::size_t offset;
+    std::size_t length;
+    int pat;
+};
+
+namespace detail {
+enum : std::size_t { min_parallel_chunk_size = 0x100000, max_line_search_size = 0x1000 };
+
+// Tokenizes lexemes starting in [pos, stop) with `sc` start condition, `sync` is called with each lexeme end and stops
+// the analysis if returns `true`; returns the end of the last lexeme
+template<typename State, typename Lex, typename SyncFunc>
+std::size_t tokenizeRange(const Lex& lex, std::string_view text, std::size_t pos, std::size_t stop, int sc,
+                          std::vector<State>& state_stack, std::vector<token>& tokens, SyncFunc sync) {
+    const char* last = text.data() + text.size();
+    State* sptr = state_stack.data();
+    *sptr++ = static_cast<State>(sc);
+    while (pos < stop) {
+        const char* first = text.data() + pos;
+        const int flags = pos == 0 || text[pos - 1] == '\n' ? flag_at_beg_of_line : 0;
+        std::size_t llen = 0;
+        int pat = 0;
+        while (true) {
+            const char* trimmed_last = last;
+            const State* slast = state_stack.data() + state_stack.size();
+            if (slast - sptr < last - first) { trimmed_last = first + (slast - sptr); }
+            pat = lex(first, trimmed_last, &sptr, &llen, trimmed_last != last ? flags | flag_has_more : flags);
+            if (pat >= predef_pat_default) { break; }  // Full lexeme is obtained
+            const std::ptrdiff_t depth = sptr - state_stack.data();
+            state_stack.resize(2 * state_stack.size());
+            sptr = state_stack.data() + depth;
+            first = trimmed_last;
+        }
+        tokens.push_back(token{pos, llen, pat});
+        pos += llen;
+        if (sync(pos)) { break; }
+    }
+    return pos;
+}
+
+// Calls `func(n)` for n in [0, count) in `count` threads
+template<typename Func>
+void runParallel(unsigned count, const Func& func) {
+    std::vector<std::exception_ptr> errors(count);
+    auto worker = [&func, &errors](unsigned n) {
+        try {
+            func(n);
+        } catch (...) { errors[n] = std::current_exception(); }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (unsigned n = 1; n < count; ++n) { threads.emplace_back(worker, n); }
+    worker(0);
+    for (auto& thread : threads) { thread.join(); }
+    for (const auto& error : errors) {
+        if (error) { std::rethrow_exception(error); }
+    }
+}
+}  // namespace detail
+
+// Tokenizes `text` with `sc` start condition in `thread_count` threads (hardware concurrency if 0), the result is
+// the same as of sequential `lex()` calls; `State` is the state stack type, `Lex` is the generated `lex()` function or
+// any callable with the same contract
+template<typename State, typename Lex>
+std::vector<token> lex_parallel(Lex lex, std::string_view text, unsigned thread_count = 0, int sc = 0) {
+    if (thread_count == 0) { thread_count = std::max(std::thread::hardware_concurrency(), 1u); }
+    const std::size_t max_chunk_count = std::max<std::size_t>(text.size() / detail::min_parallel_chunk_size, 1);
+    const unsigned chunk_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, max_chunk_count));
+
+    // Chunks start after line ends if possible, where speculative analysis synchronizes faster
+    std::vector<std::size_t> bounds(chunk_count + 1, text.size());
+    bounds[0] = 0;
+    for (unsigned n = 1; n < chunk_count; ++n) {
+        const std::size_t pos = n * (text.size() / chunk_count);
+        const std::size_t nl_pos = text.find('\n', pos);
+        bounds[n] = nl_pos != std::string_view::npos && nl_pos - pos < detail::max_line_search_size ? nl_pos + 1 : pos;
+    }
+
+    struct chunk_info {
+        std::vector<token> tokens;  // Speculative tokens
+        std::vector<token> fixup;   // Valid tokens, which precede the first valid speculative token
+        std::size_t first_valid = 0;
+        std::size_t dest_pos = 0;
+    };
+
+    std::vector<chunk_info> chunks(chunk_count);
+    detail::runParallel(chunk_count, [&](unsigned n) {
+        std::vector<State> state_stack(256);
+        chunks[n].tokens.reserve((bounds[n + 1] - bounds[n]) / 8);
+        detail::tokenizeRange(lex, text, bounds[n], bounds[n + 1], sc, state_stack, chunks[n].tokens,
+                              [](std::size_t) { return false; });
+    });
+
+    // Stitch chunks: the end of the last valid lexeme of the previous chunk must be a speculative lexeme boundary,
+    // otherwise the chunk is reanalyzed from this end till such a boundary is reached
+    std::vector<State> state_stack(256);
+    std::size_t pos = chunks[0].tokens.empty() ? 0 : chunks[0].tokens.back().offset + chunks[0].tokens.back().length;
+    std::size_t token_count = chunks[0].tokens.size();
+    for (unsigned n = 1; n < chunk_count; ++n) {
+        auto& chunk = chunks[n];
+        auto find_boundary = [&chunk](std::size_t offset) {
+            const auto it = std::lower_bound(chunk.tokens.begin() + chunk.first_valid, chunk.tokens.end(), offset,
+                                             [](const token& t, std::size_t offset) { return t.offset < offset; });
+            return static_cast<std::size_t>(it - chunk.tokens.begin());
+        };
+        chunk.first_valid = find_boundary(pos);
+        if (chunk.first_valid == chunk.tokens.size() || chunk.tokens[chunk.first_valid].offset != pos) {
+            bool synchronized = false;
+            pos = detail::tokenizeRange(lex, text, pos, bounds[n + 1], sc, state_stack, chunk.fixup,
+                                        [&chunk, &find_boundary, &synchronized](std::size_t offset) {
+                                            chunk.first_valid = find_boundary(offset);
+                                            synchronized = chunk.first_valid != chunk.tokens.size() &&
+                                                           chunk.tokens[chunk.first_valid].offset == offset;
+                                            return synchronized;
+                                        });
+            if (!synchronized) { chunk.first_valid = chunk.tokens.size(); }
+        }
+        if (chunk.first_valid != chunk.tokens.size()) { pos = chunk.tokens.back().offset + chunk.tokens.back().length; }
+        chunk.dest_pos = token_count;
+        token_count += chunk.fixup.size() + chunk.tokens.size() - chunk.first_valid;
+    }
+
+    std::vector<token> result(token_count);
+    detail::runParallel(chunk_count, [&](unsigned n) {
+        const auto& chunk = chunks[n];
+        auto dest = std::copy(chunk.fixup.begin(), chunk.fixup.end(), result.begin() + chunk.dest_pos);
+        std::copy(chunk.tokens.begin() + chunk.first_valid, chunk.tokens.end(), dest);
+    });
+    return result;
+}
+
+}  // namespace lexegen
@@ -0,0 +1,183 @@
+#pragma once
+
+// Streaming driver for generated analyzers: it owns a refillable input window and the state stack, so `lex()` is
+// called with `flag_has_more` and the stack is enlarged without user code, and input of any size is tokenized in
+// bounded memory
+
+#include "defs.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+namespace lexegen {
+
+// Input sources: read up to `size` characters to `buf` and return the count, 0 means the end of input and a negative
+// value means a read error
+
+class fd_source {
+ public:
+    explicit fd_source(int fd) : fd_(fd) {}
+    std::ptrdiff_t operator()(char* buf, std::size_t size) const {
+#if defined(_WIN32)
+        const int count = ::_read(fd_, buf, static_cast<unsigned>(size < 0x40000000 ? size : 0x40000000));
+#else
+        ssize_t count = 0;
+        do { count = ::read(fd_, buf, size); } while (count < 0 && errno == EINTR);
+#endif
+        return count >= 0 ? static_cast<std::ptrdiff_t>(count) : -1;
+    }
+
+ private:
+    int fd_;
+};
+
+class file_source {
+ public:
+    explicit file_source(std::FILE* fp) : fp_(fp) {}
+    std::ptrdiff_t operator()(char* buf, std::size_t size) const {
+        const std::size_t count = std::fread(buf, 1, size, fp_);
+        return count == 0 && std::ferror(fp_) ? -1 : static_cast<std::ptrdiff_t>(count);
+    }
+
+ private:
+    std::FILE* fp_;
+};
+
+// `State` is the state stack type, `Stackless` is `true` for analyzers generated with `--stackless` option, `Lex` is
+// the generated `lex()` function or any callable with the same contract
+template<typename State, bool Stackless = false,
+         typename Lex = int (*)(const char*, const char*, State**, std::size_t*, int)>
+class scanner {
+ public:
+    using source_type = std::function<std::ptrdiff_t(char*, std::size_t)>;
+
+    enum : std::size_t { default_buffer_size = 0x10000, initial_stack_size = 256 };
+
+    // Stackless analyzer needs only three free cells over the start conditions to suspend the analysis, so the stack is
+    // not trimmed and does not grow with the lexeme
+    enum : std::size_t { suspend_cell_count = Stackless ? 3 : 0 };
+
+    // Reads input from `source` through the window of `buffer_size` characters, which grows only for longer lexemes
+    scanner(Lex lex, source_type source, std::size_t buffer_size = default_buffer_size)
+        : lex_(std::move(lex)), source_(std::move(source)), buffer_(new char[buffer_size]), capacity_(buffer_size) {
+        window_ = first_ = last_ = buffer_.get();
+        init();
+    }
+
+    // Tokenizes text, which is entirely in memory (e.g. a mapped file), lexemes point to the text
+    scanner(Lex lex, std::string_view text) : lex_(std::move(lex)) {
+        window_ = first_ = text.data(), last_ = first_ + text.size();
+        at_end_ = true;
+        init();
+    }
+
+    // The state stack bottom is also the start condition stack
+    int start_condition() const { return static_cast<int>(state_stack_[sc_depth_ - 1]); }
+    void push_start_condition(int sc) {
+        if (sc_depth_ + suspend_cell_count >= state_stack_.size()) { state_stack_.resize(2 * state_stack_.size()); }
+        state_stack_[sc_depth_++] = static_cast<State>(sc);
+    }
+    void pop_start_condition() { --sc_depth_; }
+    void set_start_condition(int sc) { state_stack_[sc_depth_ - 1] = static_cast<State>(sc); }
+
+    // Offset of the last lexeme from the beginning of input
+    std::uint64_t offset() const { return window_offset_ + static_cast<std::uint64_t>(lexeme_ - window_); }
+
+    // True if the input is stopped by a read error of the source, the unfinished lexeme is dropped in this case
+    bool failed() const { return failed_; }
+
+    // Returns the next pattern or `err_end_of_input` (see also `failed()`), the lexeme is valid till the next call
+    int next(std::string_view& lexeme) {
+        const int flags = at_beg_of_line_ ? flag_at_beg_of_line : 0;
+        const char* first = first_;
+        State* sptr = state_stack_.data() + sc_depth_;
+        std::size_t llen = 0;
+        while (true) {
+            const char* trimmed_last = last_;
+            if constexpr (!Stackless) {
+                const State* slast = state_stack_.data() + state_stack_.size();
+                if (slast - sptr < last_ - first) { trimmed_last = first + (slast - sptr); }
+            }
+            const bool has_more = trimmed_last != last_ || !at_end_;
+            const int pat = lex_(first, trimmed_last, &sptr, &llen, has_more ? flags | flag_has_more : flags);
+            if (pat >= predef_pat_default) {  // Full lexeme is obtained
+                lexeme = std::string_view(first_, llen);
+                lexeme_ = first_;
+                at_beg_of_line_ = lexeme.back() == '\n';
+                first_ += llen;
+                return pat;
+            }
+            if (!has_more) { return err_end_of_input; }
+            if (trimmed_last != last_) {  // State stack is full
+                const std::ptrdiff_t depth = sptr - state_stack_.data();
+                state_stack_.resize(2 * state_stack_.size());
+                sptr = state_stack_.data() + depth;
+            } else {
+                const std::ptrdiff_t scanned = last_ - first_;
+                refill();
+                if (failed_) { return err_end_of_input; }
+                trimmed_last = first_ + scanned;
+            }
+            first = trimmed_last;
+        }
+    }
+
+ private:
+    Lex lex_;
+    source_type source_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t capacity_ = 0;
+    const char* window_ = nullptr;  // The window beginning, which is at `window_offset_` of input
+    const char* first_ = nullptr;   // The beginning of the next lexeme, the input before it is consumed
+    const char* last_ = nullptr;
+    const char* lexeme_ = nullptr;
+    std::uint64_t window_offset_ = 0;
+    std::vector<State> state_stack_;
+    std::size_t sc_depth_ = 1;
+    bool at_beg_of_line_ = true;
+    bool at_end_ = false;
+    bool failed_ = false;
+
+    void init() {
+        lexeme_ = first_;
+        state_stack_.resize(initial_stack_size);
+        state_stack_[0] = 0;  // Initial start condition
+    }
+
+    // Moves the unfinished lexeme to the window beginning and reads more input, the window is enlarged if the lexeme
+    // occupies it entirely
+    void refill() {
+        const std::size_t tail_size = static_cast<std::size_t>(last_ - first_);
+        char* buf = buffer_.get();
+        if (tail_size == capacity_) {
+            std::unique_ptr<char[]> new_buffer(new char[2 * capacity_]);
+            std::memcpy(new_buffer.get(), first_, tail_size);
+            buffer_ = std::move(new_buffer), capacity_ *= 2, buf = buffer_.get();
+        } else if (first_ != buf) {
+            std::memmove(buf, first_, tail_size);
+        }
+        window_offset_ += static_cast<std::uint64_t>(first_ - window_);
+        window_ = first_ = lexeme_ = buf, last_ = buf + tail_size;
+        const std::ptrdiff_t count = source_(buf + tail_size, capacity_ - tail_size);
+        if (count <= 0) {
+            at_end_ = true, failed_ = count < 0;
+            return;
+        }
+        last_ += count;
+    }
+};
+
+}  // namespace lexegen
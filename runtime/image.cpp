@@ -0,0 +1,136 @@
+#include "lexegen/image.h"
+
+#include <algorithm>
+
+namespace lexegen {
+
+bool dfa_image::attach(const void* data, std::size_t size) {
+    detach();
+    if (!data || size < sizeof(image_header) || reinterpret_cast<std::uintptr_t>(data) % alignof(std::int32_t)) {
+        return false;
+    }
+    const auto* header = static_cast<const image_header*>(data);
+    if (header->magic != image_magic || header->version != image_version || header->image_size > size ||
+        header->state_count == 0) {
+        return false;
+    }
+
+    auto table_fits = [header](std::uint32_t offset, std::uint64_t count, std::uint64_t item_size) {
+        return offset >= sizeof(image_header) && offset % alignof(std::int32_t) == 0 &&
+               offset + count * item_size <= header->image_size;
+    };
+    const std::uint64_t state_count = header->state_count;
+    const bool has_lls = (header->flags & image_flag_has_trailing_context) != 0;
+    if (!table_fits(header->symb2meta_offset, 256, 1) ||
+        !table_fits(header->def_offset, state_count, sizeof(std::int32_t)) ||
+        !table_fits(header->base_offset, state_count, sizeof(std::int32_t)) ||
+        !table_fits(header->next_offset, header->transition_count, sizeof(std::int32_t)) ||
+        !table_fits(header->check_offset, header->transition_count, sizeof(std::int32_t)) ||
+        !table_fits(header->accept_offset, state_count, sizeof(std::int32_t)) ||
+        (has_lls && (!table_fits(header->lls_idx_offset, state_count + 1, sizeof(std::int32_t)) ||
+                     !table_fits(header->lls_list_offset, header->lls_list_size, sizeof(std::int32_t))))) {
+        return false;
+    }
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    auto get_table = [bytes](std::uint32_t offset) { return reinterpret_cast<const std::int32_t*>(bytes + offset); };
+    const std::uint8_t* symb2meta = bytes + header->symb2meta_offset;
+    const std::int32_t* def = get_table(header->def_offset);
+    const std::int32_t* base = get_table(header->base_offset);
+    const std::int32_t* next = get_table(header->next_offset);
+    const std::int32_t* lls_idx = has_lls ? get_table(header->lls_idx_offset) : nullptr;
+
+    // Check all values used as indices, so `lex()` can not read out of the tables: each transition probe of a state
+    // must be inside `next` and `check`, and the default state must precede the state, so default chains end
+    std::int64_t meta_count = 0;  // Maximum meta-symbol, then meta-symbol count
+    for (unsigned symb = 0; symb < 256; ++symb) { meta_count = std::max<std::int64_t>(meta_count, symb2meta[symb]); }
+    ++meta_count;
+    const std::int64_t transition_count = header->transition_count;
+    for (std::int64_t state = 0; state < static_cast<std::int64_t>(state_count); ++state) {
+        if (def[state] < -1 || def[state] >= state || base[state] < 0 || base[state] + meta_count > transition_count) {
+            return false;
+        }
+        if (has_lls && (lls_idx[state] < 0 || lls_idx[state] > lls_idx[state + 1] ||
+                        lls_idx[state + 1] > static_cast<std::int64_t>(header->lls_list_size))) {
+            return false;
+        }
+    }
+    for (std::int64_t l = 0; l < transition_count; ++l) {
+        if (next[l] < -1 || next[l] >= static_cast<std::int64_t>(state_count)) { return false; }
+    }
+
+    header_ = header;
+    symb2meta_ = symb2meta;
+    def_ = def;
+    base_ = base;
+    next_ = next;
+    check_ = get_table(header->check_offset);
+    accept_ = get_table(header->accept_offset);
+    lls_idx_ = lls_idx;
+    lls_list_ = has_lls ? get_table(header->lls_list_offset) : nullptr;
+    return true;
+}
+
+int dfa_image::lex(const char* first, const char* last, int** p_sptr, std::size_t* p_llen, int flags) const {
+    int* sptr = *p_sptr;
+    int* sptr0 = sptr - *p_llen;
+    // Note: the start condition is on the top of the stack only if the analysis is not resumed
+    int state = *(sptr - 1);
+    if (!*p_llen && (header_->flags & image_flag_has_left_nl_anchoring)) {
+        state = (state << 1) + ((flags & flag_at_beg_of_line) ? 1 : 0);
+    }
+    while (first != last) {  // Analyze till transition is impossible
+        const int meta = symb2meta_[static_cast<unsigned char>(*first)];
+        do {
+            const int l = base_[state] + meta;
+            if (check_[l] == state) {
+                state = next_[l];
+                break;
+            }
+            state = def_[state];
+        } while (state >= 0);
+        if (state < 0) { break; }
+        *sptr++ = state, ++first;
+    }
+    if (first == last && ((flags & flag_has_more) || sptr == sptr0)) {
+        *p_sptr = sptr;
+        *p_llen = static_cast<std::size_t>(sptr - sptr0);
+        return err_end_of_input;
+    }
+    *p_sptr = sptr0;
+    return unroll(sptr0, sptr, p_llen);
+}
+
+int dfa_image::unroll(const int* sptr0, const int* sptr, std::size_t* p_llen) const {
+    while (sptr != sptr0) {  // Unroll down to last accepting state
+        int state = *(sptr - 1);
+        int n_pat = accept_[state];
+        if (n_pat > 0) {
+            if (lls_idx_) {
+                enum { trailing_context_flag = 1, flag_count = 1 };
+                if (!(n_pat & trailing_context_flag)) {
+                    *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                    return n_pat >> flag_count;
+                }
+                n_pat >>= flag_count;
+                do {
+                    for (int i = lls_idx_[state]; i < lls_idx_[state + 1]; ++i) {
+                        if (lls_list_[i] == n_pat) {
+                            *p_llen = static_cast<std::size_t>(sptr - sptr0);
+                            return n_pat;
+                        }
+                    }
+                    state = *(--sptr - 1);
+                } while (sptr != sptr0);
+                break;  // No head of the trailing context in a corrupt image, but the lexeme can't be empty
+            }
+            *p_llen = static_cast<std::size_t>(sptr - sptr0);
+            return n_pat;
+        }
+        --sptr;
+    }
+    *p_llen = 1;  // Accept at least one symbol as default pattern
+    return predef_pat_default;
+}
+
+}  // namespace lexegen
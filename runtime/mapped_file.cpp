@@ -0,0 +1,66 @@
+#include "lexegen/mapped_file.h"
+
+#if defined(_WIN32)
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace lexegen {
+
+bool mapped_file::open(const char* file_name) {
+    close();
+#if defined(_WIN32)
+    HANDLE file = ::CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size)) {
+        ::CloseHandle(file);
+        return false;
+    }
+    if (file_size.QuadPart > 0) {
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data_ = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            ::CloseHandle(mapping);  // The view keeps the mapping
+        }
+    }
+    ::CloseHandle(file);  // The mapping keeps the file open
+    if (file_size.QuadPart > 0 && !data_) { return false; }
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+#else
+    const int fd = ::open(file_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size > 0) {
+        void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) { data_ = data; }
+    }
+    ::close(fd);  // The mapping keeps the file open
+    if (st.st_size > 0 && !data_) { return false; }
+    size_ = static_cast<std::size_t>(st.st_size);
+#endif
+    is_open_ = true;
+    return true;
+}
+
+void mapped_file::close() {
+    if (data_) {
+#if defined(_WIN32)
+        ::UnmapViewOfFile(data_);
+#else
+        ::munmap(data_, size_);
+#endif
+    }
+    data_ = nullptr, size_ = 0, is_open_ = false;
+}
+
+}  // namespace lexegen
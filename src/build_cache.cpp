@@ -0,0 +1,84 @@
+#include "build_cache.h"
+
+#include "file_util.h"
+#include "logger.h"
+
+#include <uxs/io/filebuf.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <random>
+
+namespace {
+std::uint64_t calcHash(std::string_view text) {  // FNV-1a hash
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (char ch : text) { hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ull; }
+    return hash;
+}
+
+// Entry is a sequence of chunks: the key and the files, each chunk has the form: <size>\n<data>
+void appendChunk(std::string& entry, std::string_view data) {
+    entry += uxs::to_string(data.size());
+    entry += '\n';
+    entry += data;
+}
+
+bool readChunk(std::string_view& entry, std::string_view& data) {
+    std::size_t size = 0, n = 0;
+    for (; n < entry.size() && entry[n] >= '0' && entry[n] <= '9'; ++n) { size = 10 * size + (entry[n] - '0'); }
+    if (n == 0 || n == entry.size() || entry[n] != '\n' || entry.size() - n - 1 < size) { return false; }
+    data = entry.substr(n + 1, size);
+    entry.remove_prefix(n + 1 + size);
+    return true;
+}
+}  // namespace
+
+//---------------------------------------------------------------------------------------
+
+BuildCache::BuildCache(std::string dir, std::string key) : dir_(std::move(dir)), key_(std::move(key)) {
+    entry_path_ = (std::filesystem::path(dir_) / uxs::format("{:016x}.lexcache", calcHash(key_))).string();
+}
+
+bool BuildCache::restore(std::span<const std::string> file_names) const {
+    std::string entry_text;
+    if (!readFile(entry_path_, entry_text)) { return false; }
+
+    // Compare the whole key, so hash collisions are harmless
+    std::string_view entry(entry_text), data;
+    if (!readChunk(entry, data) || data != key_) { return false; }
+
+    std::vector<std::string_view> files(file_names.size());
+    for (auto& file : files) {
+        if (!readChunk(entry, file)) { return false; }
+    }
+    if (!entry.empty()) { return false; }
+
+    for (std::size_t n = 0; n < file_names.size(); ++n) {
+        if (!writeFile(file_names[n], files[n])) {
+            logger::error().println("could not open output file `{}`", file_names[n]);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BuildCache::store(std::span<const std::string> file_names) const {
+    std::string entry, text;
+    appendChunk(entry, key_);
+    for (const auto& file_name : file_names) {
+        if (!readFile(file_name, text)) { return false; }
+        appendChunk(entry, text);
+    }
+
+    // Write to a temporary file and rename it, so concurrent runs never see a partially written entry
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    std::string tmp_path = uxs::format("{}.{:08x}.tmp", entry_path_, std::random_device{}());
+    if (!writeFile(tmp_path, entry)) { return false; }
+    std::filesystem::rename(tmp_path, entry_path_, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
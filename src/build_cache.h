@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+// Build cache: keeps generated files in a cache directory, an entry is addressed by the hash of its key, which
+// consists of the tool version, output affecting options and the input file contents
+class BuildCache {
+ public:
+    BuildCache(std::string dir, std::string key);
+
+    const std::string& getEntryPath() const { return entry_path_; }
+    bool restore(std::span<const std::string> file_names) const;  // Copies cached files to `file_names`
+    bool store(std::span<const std::string> file_names) const;    // Puts files `file_names` into the cache
+
+ private:
+    std::string dir_;
+    std::string key_;
+    std::string entry_path_;
+};
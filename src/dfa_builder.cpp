@@ -1,25 +1,62 @@
 #include "dfa_builder.h"
 
 #include "logger.h"
+#include "time_report.h"
 
 #include <uxs/algorithm.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 
-void DfaBuilder::addPattern(std::unique_ptr<Node> syn_tree, unsigned n_pat, const ValueSet& sc) {
-    if (n_pat > ValueSet::kMaxValue) { throw std::runtime_error("too many patterns"); }
-    auto cat_node = std::make_unique<Node>(NodeType::kCat);
-    cat_node->setRight(std::make_unique<TermNode>(n_pat));  // Add $end node
-    cat_node->setLeft(std::move(syn_tree));
-    patterns_.emplace_back(sc, std::move(cat_node));
-}
+namespace {
+// Interned DFA states: position set -> state index; the table is split into shards with separate locks, so it
+// can be shared between threads
+class StateTable {
+ public:
+    explicit StateTable(unsigned shard_count) : shards_(shard_count) {}
 
-bool DfaBuilder::isPatternWithTrailingContext(unsigned n_pat) const {
-    return uxs::any_of(patterns_, [n_pat](const auto& pat) {
-        return static_cast<const TermNode*>(pat.syn_tree->getRight())->getPatternNo() == n_pat &&
-               pat.syn_tree->getLeft()->getType() == NodeType::kTrailingContext;
-    });
+    unsigned getStateCount() const { return state_count_; }
+
+    void reserve(std::size_t count) {
+        for (auto& shard : shards_) { shard.state_ids.reserve(count / shards_.size()); }
+    }
+
+    // Returns the interned position set, the index of the state and `true` if the state is new
+    std::tuple<const ValueSet*, unsigned, bool> intern(ValueSet T) {
+        auto& shard = shards_[std::hash<ValueSet>{}(T) % shards_.size()];
+        std::lock_guard lock(shard.mutex);
+        auto [it, success] = shard.state_ids.try_emplace(std::move(T), 0);
+        if (success) { it->second = state_count_++; }
+        return {&it->first, it->second, success};
+    }
+
+    // Note: start states are always distinct, even if their position sets coincide
+    std::pair<const ValueSet*, unsigned> addStartState(ValueSet S) {
+        auto [T, idx, success] = intern(std::move(S));
+        return {T, success ? idx : state_count_++};
+    }
+
+ private:
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<ValueSet, unsigned> state_ids;
+    };
+    std::vector<Shard> shards_;
+    std::atomic<unsigned> state_count_{0};
+};
+}  // namespace
+
+void DfaBuilder::addPattern(const Node* syn_tree, unsigned n_pat, const ValueSet& sc) {
+    // Add $end node
+    patterns_.emplace_back(sc, node_pool_.newNode(NodeType::kCat, syn_tree, node_pool_.newTermNode(n_pat)));
+    if (syn_tree->getType() == NodeType::kTrailingContext) { trailing_context_patterns_.addValue(n_pat); }
 }
 
 bool DfaBuilder::hasPatternsWithLeftNlAnchoring() const {
@@ -29,37 +66,113 @@ bool DfaBuilder::hasPatternsWithLeftNlAnchoring() const {
     });
 }
 
-void DfaBuilder::build(unsigned sc_count, bool case_insensitive) {
-    std::vector<PositionalNode*> positions;
-    std::vector<ValueSet> states;
+void DfaBuilder::build(unsigned sc_count, bool case_insensitive, unsigned thread_count) {
+    std::vector<const Node*> positions;
+    std::vector<ValueSet> followpos;
+    thread_count = std::max(thread_count, 1u);
+    StateTable state_table(thread_count > 1 ? 16 * thread_count : 1);
+    std::vector<const ValueSet*> states;  // Position sets of states, point to `state_table` keys
 
     bool left_nl_anchoring = hasPatternsWithLeftNlAnchoring();
     start_state_count_ = sc_count + (left_nl_anchoring ? sc_count : 0);
 
     // Scatter positions and calculate node functions
-    positions.reserve(1024);
-    for (const auto& pat : patterns_) { pat.syn_tree->calcFunctions(positions); }
+    TimeReport::Phase phase(time_report_, "node functions");
+    std::size_t position_count = 0;
+    for (const auto& pat : patterns_) { position_count += pat.syn_tree->getPositionCount(); }
+    positions.reserve(position_count);
+    followpos.reserve(position_count);
+    for (auto& pat : patterns_) { pat.firstpos = calcFunctions(pat.syn_tree, positions, followpos).firstpos; }
 
     logger::info(file_name_).println(" - pattern count: {}", patterns_.size());
     logger::info(file_name_).println(" - S-state count: {}", start_state_count_);
     logger::info(file_name_).println(" - position count: {}", positions.size());
 
-    auto calc_eps_closure = [&positions](const ValueSet& T) {
+    auto get_symb_set = [case_insensitive](const Node* pos_node) {
+        ValueSet sset;
+        if (pos_node->getType() == NodeType::kSymbol) {
+            sset.addValue(pos_node->getSymbol());
+        } else if (pos_node->getType() == NodeType::kSymbSet) {
+            sset = pos_node->getSymbSet();
+        }
+        if (case_insensitive) {  // Lowercase letters are matched by uppercase letters
+            for (unsigned symb = 0; symb < kSymbCount; ++symb) {
+                if (std::islower(symb) && sset.contains(symb)) { sset.removeValue(symb).addValue(std::toupper(symb)); }
+            }
+        }
+        sset.removeValue(0);  // '\0' is always a dead symbol
+        return sset;
+    };
+
+    // Collect distinct symbol sets of positions
+    phase.next("symbol classes");
+    std::unordered_map<ValueSet, unsigned> symb_set_ids;
+    std::vector<const ValueSet*> symb_sets;
+    std::vector<unsigned> pos_symb_set(positions.size());
+    for (unsigned pos = 0; pos < positions.size(); ++pos) {
+        auto [it, success] = symb_set_ids.try_emplace(get_symb_set(positions[pos]),
+                                                      static_cast<unsigned>(symb_sets.size()));
+        if (success) { symb_sets.push_back(&it->first); }
+        pos_symb_set[pos] = it->second;
+    }
+
+    // Split the alphabet into equivalence classes: the symbols of one class belong or do not belong to each
+    // symbol set simultaneously, so they always lead to the same transitions
+    std::vector<unsigned> symb2class(kSymbCount, 0);
+    std::vector<unsigned> class_size{kSymbCount};
+    for (const auto* sset : symb_sets) {
+        std::vector<unsigned> in_count(class_size.size(), 0);
+        for (unsigned symb : *sset) { ++in_count[symb2class[symb]]; }
+        std::vector<int> new_class(class_size.size(), -1);
+        for (unsigned cls = 0; cls < in_count.size(); ++cls) {
+            if (in_count[cls] > 0 && in_count[cls] < class_size[cls]) {  // The class needs splitting
+                new_class[cls] = static_cast<int>(class_size.size());
+                class_size.push_back(in_count[cls]);
+                class_size[cls] -= in_count[cls];
+            }
+        }
+        for (unsigned symb : *sset) {
+            if (int cls = new_class[symb2class[symb]]; cls >= 0) { symb2class[symb] = cls; }
+        }
+    }
+
+    // Renumber classes in order of their first symbols, so the class of dead '\0' symbol becomes zero class
+    unsigned class_count = 0;
+    std::vector<int> class_order(class_size.size(), -1);
+    for (auto& cls : symb2class) {
+        if (class_order[cls] < 0) { class_order[cls] = class_count++; }
+        cls = class_order[cls];
+    }
+
+    // Calculate class lists for symbol sets
+    std::vector<std::vector<unsigned>> set_classes(symb_sets.size());
+    for (unsigned n = 0; n < symb_sets.size(); ++n) {
+        for (unsigned symb : *symb_sets[n]) { set_classes[n].push_back(symb2class[symb]); }
+        std::sort(set_classes[n].begin(), set_classes[n].end());
+        set_classes[n].erase(std::unique(set_classes[n].begin(), set_classes[n].end()), set_classes[n].end());
+    }
+
+    logger::info(file_name_).println(" - symbol class count: {}", class_count);
+
+    auto calc_eps_closure = [&positions, &followpos](const ValueSet& T) {
         ValueSet closure = T;
         for (unsigned pos : T) {
-            if (positions[pos]->getType() == NodeType::kTrailingContext) { closure |= positions[pos]->getFollowpos(); }
+            if (positions[pos]->getType() == NodeType::kTrailingContext) { closure |= followpos[pos]; }
         }
         return closure;
     };
 
-    auto add_state = [&Dtran = Dtran_, &states](const ValueSet& T) {
+    phase.next("subset construction");
+
+    auto add_state = [&Dtran = Dtran_, &states](const ValueSet* T) {
         states.push_back(T);
-        Dtran.emplace_back();
-        Dtran.back().fill(-1);
+        Dtran.resize(states.size());
         return static_cast<unsigned>(states.size()) - 1;
     };
 
     std::vector<unsigned> pending_states;
+    Dtran_ = DtranTable(class_count);
+    state_table.reserve(100 * start_state_count_);
     states.reserve(100 * start_state_count_);
     Dtran_.reserve(100 * start_state_count_);
     pending_states.reserve(100 * start_state_count_);
@@ -69,100 +182,198 @@ void DfaBuilder::build(unsigned sc_count, bool case_insensitive) {
         ValueSet S;
         for (const auto& pat : patterns_) {
             if (pat.sc.contains(sc) && pat.syn_tree->getLeft()->getType() != NodeType::kLeftNlAnchoring) {
-                S |= pat.syn_tree->getFirstpos();
+                S |= pat.firstpos;
             }
         }
-        pending_states.push_back(add_state(calc_eps_closure(S)));
+        pending_states.push_back(add_state(state_table.addStartState(calc_eps_closure(S)).first));
         if (left_nl_anchoring) {
             ValueSet S;
             for (const auto& pat : patterns_) {
                 if (pat.sc.contains(sc) && pat.syn_tree->getLeft()->getType() != NodeType::kLeftNotNlAnchoring) {
-                    S |= pat.syn_tree->getFirstpos();
+                    S |= pat.firstpos;
                 }
             }
-            pending_states.push_back(add_state(calc_eps_closure(S)));
+            pending_states.push_back(add_state(state_table.addStartState(calc_eps_closure(S)).first));
         }
     }
 
-    // Calculate other states and build DFA
-    do {
-        unsigned T_idx = pending_states.back();
-        pending_states.pop_back();
-
-        auto node_contains_symb = [case_insensitive](const auto* pos_node, unsigned symb) {
-            auto type = pos_node->getType();
-            if (type == NodeType::kSymbol) {
-                const auto* symb_node = static_cast<const SymbNode*>(pos_node);
-                return symb_node->getSymbol() == symb ||
-                       (case_insensitive && symb_node->getSymbol() == static_cast<unsigned>(std::tolower(symb)));
-            } else if (type == NodeType::kSymbSet) {
-                const auto* sset_node = static_cast<const SymbSetNode*>(pos_node);
-                return sset_node->getSymbSet().contains(symb) ||
-                       (case_insensitive && sset_node->getSymbSet().contains(std::tolower(symb)));
+    // Calls `on_target(cls, U)` for each transition from state `T`, `U` is the target position set; the classes
+    // are ordered by their first symbols, so targets are enumerated in the same order as if all symbols were
+    std::atomic<std::uint64_t> union_count{0}, lookup_count{0};
+    auto expand_state = [&](const ValueSet& T, std::vector<ValueSet>& U, const auto& on_target) {
+        std::uint64_t unions = 0, lookups = 0;
+        for (unsigned pos : T) {
+            for (unsigned cls : set_classes[pos_symb_set[pos]]) { U[cls] |= followpos[pos], ++unions; }
+        }
+        for (unsigned cls = 1; cls < class_count; ++cls) {
+            if (!U[cls].empty()) {
+                on_target(cls, calc_eps_closure(U[cls]));
+                U[cls].clear(), ++lookups;
             }
-            return false;
-        };
-
-        ValueSet T = states[T_idx];
+        }
+        union_count.fetch_add(unions, std::memory_order_relaxed);
+        lookup_count.fetch_add(lookups, std::memory_order_relaxed);
+    };
 
-        for (unsigned symb = 0; symb < kSymbCount; ++symb) {
-            if (case_insensitive && std::islower(symb)) { continue; }
+    // Calculate other states and build DFA
+    if (thread_count == 1) {
+        std::vector<ValueSet> U(class_count);
+        do {
+            unsigned T_idx = pending_states.back();
+            pending_states.pop_back();
+            expand_state(*states[T_idx], U, [&](unsigned cls, ValueSet U_closure) {
+                auto [T, idx, success] = state_table.intern(std::move(U_closure));
+                if (success) { pending_states.push_back(add_state(T)); }
+                Dtran_[T_idx][cls] = idx;
+            });
+        } while (!pending_states.empty());
+    } else {
+        logger::info(file_name_).println(" - thread count: {}", thread_count);
+
+        // Expand states level by level: each level is shared between worker threads, which add found states
+        // to the common state table
+        std::vector<unsigned> level;
+        level.swap(pending_states);
+        std::vector<std::vector<std::pair<unsigned, const ValueSet*>>> new_states(thread_count);
+        std::vector<std::exception_ptr> errors(thread_count);
+        do {
+            std::atomic<unsigned> next_item{0};
+            auto worker = [&](unsigned n_thread) {
+                try {
+                    std::vector<ValueSet> U(class_count);
+                    for (unsigned item = next_item++; item < level.size(); item = next_item++) {
+                        unsigned T_idx = level[item];
+                        expand_state(*states[T_idx], U, [&](unsigned cls, ValueSet U_closure) {
+                            auto [T, idx, success] = state_table.intern(std::move(U_closure));
+                            if (success) { new_states[n_thread].emplace_back(idx, T); }
+                            Dtran_[T_idx][cls] = idx;
+                        });
+                    }
+                } catch (...) { errors[n_thread] = std::current_exception(); }
+            };
 
-            ValueSet U;
-            for (unsigned pos : T) {
-                if (node_contains_symb(positions[pos], symb)) { U |= positions[pos]->getFollowpos(); }
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count - 1);
+            for (unsigned n_thread = 1; n_thread < thread_count; ++n_thread) { threads.emplace_back(worker, n_thread); }
+            worker(0);
+            for (auto& thread : threads) { thread.join(); }
+            for (const auto& error : errors) {
+                if (error) { std::rethrow_exception(error); }
             }
 
-            if (!U.empty()) {
-                auto U_closure = calc_eps_closure(U);
-                if (auto [it, found] = uxs::find(states, U_closure); found) {
-                    Dtran_[T_idx][symb] = static_cast<unsigned>(it - states.begin());
-                } else {
-                    pending_states.push_back(Dtran_[T_idx][symb] = add_state(U_closure));
+            // Found states form the next level
+            level.clear();
+            states.resize(state_table.getStateCount());
+            Dtran_.resize(state_table.getStateCount());
+            for (auto& thread_states : new_states) {
+                for (const auto& [idx, T] : thread_states) {
+                    states[idx] = T;
+                    level.push_back(idx);
+                }
+                thread_states.clear();
+            }
+        } while (!level.empty());
+
+        // Renumber states in the order of single-threaded construction, so the result does not depend on thread
+        // count and scheduling
+        std::vector<int> state_order(states.size(), -1);
+        unsigned state_count = 0;
+        for (unsigned idx = 0; idx < start_state_count_; ++idx) {
+            state_order[idx] = state_count++;
+            pending_states.push_back(idx);
+        }
+        do {
+            unsigned T_idx = pending_states.back();
+            pending_states.pop_back();
+            for (unsigned cls = 1; cls < class_count; ++cls) {
+                if (int idx = Dtran_[T_idx][cls]; idx >= 0 && state_order[idx] < 0) {
+                    state_order[idx] = state_count++;
+                    pending_states.push_back(idx);
                 }
             }
+        } while (!pending_states.empty());
+
+        std::vector<const ValueSet*> ordered_states(states.size());
+        DtranTable ordered_Dtran(class_count);
+        ordered_Dtran.resize(Dtran_.size());
+        for (unsigned idx = 0; idx < states.size(); ++idx) {
+            ordered_states[state_order[idx]] = states[idx];
+            auto T = ordered_Dtran[state_order[idx]];
+            std::transform(Dtran_[idx].begin(), Dtran_[idx].end(), T.begin(),
+                           [&state_order](int state) { return state >= 0 ? state_order[state] : -1; });
         }
-    } while (pending_states.size() > 0);
+        states.swap(ordered_states);
+        Dtran_ = std::move(ordered_Dtran);
+    }
+
+    if (time_report_) {
+        time_report_->addCounter("states expanded", states.size());
+        time_report_->addCounter("ValueSet unions", union_count);
+        time_report_->addCounter("state table lookups", lookup_count);
+    }
+
+    phase.next("meta-symbols and accept tables");
 
-    auto is_dead_symb = [&Dtran = Dtran_](unsigned s) {
-        return uxs::all_of(Dtran, [s](const auto& T) { return T[s] == -1; });
+    auto is_dead_class = [&Dtran = Dtran_](unsigned cls) {
+        for (std::size_t state = 0; state < Dtran.size(); ++state) {
+            if (Dtran[state][cls] != -1) { return false; }
+        }
+        return true;
     };
 
-    auto get_equiv_symb = [&Dtran = Dtran_](unsigned s) {
-        for (unsigned s2 = 0; s2 < s; ++s2) {
-            if (uxs::all_of(Dtran, [s, s2](const auto& T) { return T[s] == T[s2]; })) { return s2; }
+    auto is_equiv_class = [&Dtran = Dtran_](unsigned cls, unsigned cls2) {
+        for (std::size_t state = 0; state < Dtran.size(); ++state) {
+            if (Dtran[state][cls] != Dtran[state][cls2]) { return false; }
         }
-        return s;
+        return true;
     };
 
+    std::vector<std::size_t> class_hash(class_count, 0);
+    for (std::size_t state = 0; state < Dtran_.size(); ++state) {
+        auto T = Dtran_[state];
+        for (unsigned cls = 0; cls < class_count; ++cls) {
+            class_hash[cls] ^= std::hash<int>{}(T[cls]) + 0x9e3779b9 + (class_hash[cls] << 6) + (class_hash[cls] >> 2);
+        }
+    }
+
+    // Merge classes leading to the same transitions into meta-symbols
+    std::vector<unsigned> class2meta(class_count, 0), meta2class;
+    meta2class.reserve(class_count);
+    meta2class.push_back(0);  // Zero class is always dead
+    meta_count_ = 1;
+    for (unsigned cls = 1; cls < class_count; ++cls) {
+        if (is_dead_class(cls)) { continue; }
+        unsigned equiv = 1;
+        while (equiv < cls && (class_hash[equiv] != class_hash[cls] || !is_equiv_class(cls, equiv))) { ++equiv; }
+        if (equiv < cls) {
+            class2meta[cls] = class2meta[equiv];
+        } else {
+            class2meta[cls] = meta_count_++;
+            meta2class.push_back(cls);
+        }
+    }
+
     // Build `symb->meta` table
     symb2meta_.resize(kSymbCount);
-    symb2meta_[0] = meta_count_++;  // '\0' is always a dead symbol
-    for (unsigned symb = 1; symb < kSymbCount; ++symb) {
+    for (unsigned symb = 0; symb < kSymbCount; ++symb) {
         if (case_insensitive && std::islower(symb)) {
-            symb2meta_[symb] = symb2meta_[std::toupper(symb)];
-        } else if (is_dead_symb(symb)) {
-            symb2meta_[symb] = 0;
-        } else if (unsigned equiv = get_equiv_symb(symb); equiv < symb) {
-            symb2meta_[symb] = symb2meta_[equiv];
+            symb2meta_[symb] = class2meta[symb2class[std::toupper(symb)]];
         } else {
-            symb2meta_[symb] = meta_count_++;
+            symb2meta_[symb] = class2meta[symb2class[symb]];
         }
     }
 
-    // Replace symbol codes with meta codes in Dtran
-    for (auto& T : Dtran_) {
-        int meta = 0;
-        T[meta++] = T[0];
-        for (unsigned symb = 1; symb < kSymbCount; ++symb) {
-            if (symb2meta_[symb] >= meta) { T[meta++] = T[symb]; }
-        }
+    // Replace class codes with meta codes in Dtran and drop unused columns
+    for (std::size_t state = 0; state < Dtran_.size(); ++state) {
+        auto T = Dtran_[state];
+        for (unsigned meta = 0; meta < meta_count_; ++meta) { T[meta] = T[meta2class[meta]]; }
     }
+    Dtran_.setWidth(meta_count_);
 
     auto get_accept = [&positions](const ValueSet& T) -> int {
         for (unsigned pos : T) {
             if (positions[pos]->getType() == NodeType::kTerm) {
-                return static_cast<const TermNode*>(positions[pos])->getPatternNo();
+                return positions[pos]->getPatternNo();
             }
         }
         return 0;
@@ -175,7 +386,7 @@ void DfaBuilder::build(unsigned sc_count, bool case_insensitive) {
             // Termination node should have the next position number
             if (positions[pos]->getType() == NodeType::kTrailingContext && pos + 1 < position_count &&
                 positions[pos + 1]->getType() == NodeType::kTerm) {
-                patterns.addValue(static_cast<const TermNode*>(positions[pos + 1])->getPatternNo());
+                patterns.addValue(positions[pos + 1]->getPatternNo());
             }
         }
         return patterns;
@@ -184,9 +395,9 @@ void DfaBuilder::build(unsigned sc_count, bool case_insensitive) {
     // Build `accept` and `LLS` tables
     accept_.reserve(states.size());
     lls_.reserve(states.size());
-    for (const auto& T : states) {
-        accept_.push_back(get_accept(T));
-        lls_.emplace_back(get_lls_patterns(T));
+    for (const auto* T : states) {
+        accept_.push_back(get_accept(*T));
+        lls_.emplace_back(get_lls_patterns(*T));
     }
 
     logger::info(file_name_).println(" - meta-symbol count: {}", meta_count_);
@@ -194,8 +405,10 @@ void DfaBuilder::build(unsigned sc_count, bool case_insensitive) {
 }
 
 void DfaBuilder::optimize() {
+    logger::info(file_name_).println(" - dead state count: {}", removeDeadStates());
+
     std::vector<unsigned> state_group(Dtran_.size());
-    std::vector<int> group_main_state;
+    std::vector<unsigned> group_main_state;
     group_main_state.reserve(Dtran_.size());
 
     // Initial state classification
@@ -220,88 +433,122 @@ void DfaBuilder::optimize() {
         state_group[state] = group;
     }
 
-    // Classify other not mandatory states
-    unsigned prev_group_count = 0;
-    do {
-        prev_group_count = static_cast<unsigned>(group_main_state.size());
+    // Refine groups with Hopcroft's algorithm: a group is split if some of its states have transitions into a
+    // splitter group and others have not; missing transitions lead to an extra sink state forming its own group
+    unsigned state_count = static_cast<unsigned>(Dtran_.size()), sink = state_count;
+
+    // Build inverse transition lists: `inv_states[inv_first[state * meta_count_ + meta]...]` are the states
+    // having transition to `state` by `meta`
+    std::vector<unsigned> inv_first((state_count + 1) * meta_count_ + 1, 0);
+    std::vector<unsigned> inv_states((state_count + 1) * meta_count_);
+    auto get_target = [sink, &Dtran = Dtran_](unsigned state, unsigned meta) {
+        return state != sink && Dtran[state][meta] >= 0 ? static_cast<unsigned>(Dtran[state][meta]) : sink;
+    };
+    for (unsigned state = 0; state <= state_count; ++state) {
         for (unsigned meta = 0; meta < meta_count_; ++meta) {
-            std::vector<std::unordered_map<int, unsigned>> group_tran(group_main_state.size());
-            std::vector<unsigned> saved_state_group = state_group;  // Use unmodified group numbers
-            for (unsigned state = 0; state < Dtran_.size(); ++state) {
-                unsigned group = saved_state_group[state];
-                int next_group = Dtran_[state][meta] >= 0 ? saved_state_group[Dtran_[state][meta]] : -1;
-                auto [it, success] = group_tran[group].emplace(next_group, group);
-                if (success && group_tran[group].size() > 1) {  // The group needs splitting, add new group
-                    state_group[state] = static_cast<unsigned>(group_main_state.size());
-                    group_main_state.push_back(state);
-                    it->second = state_group[state];
-                } else {  // Group is already created for this target group
-                    state_group[state] = it->second;
-                }
-            }
+            ++inv_first[get_target(state, meta) * meta_count_ + meta];
+        }
+    }
+    for (unsigned n = 1; n < inv_first.size(); ++n) { inv_first[n] += inv_first[n - 1]; }
+    for (unsigned state = state_count + 1; state > 0; --state) {
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            inv_states[--inv_first[get_target(state - 1, meta) * meta_count_ + meta]] = state - 1;
         }
-    } while (prev_group_count < group_main_state.size());
+    }
 
-    unsigned group_count = static_cast<unsigned>(
-        std::count_if(group_main_state.begin(), group_main_state.end(), [](int state) { return state >= 0; }));
+    // States of each group occupy a contiguous range of `group_states`, the first `group_marked_end - group_first`
+    // states of this range are marked as having transitions into the current splitter
+    unsigned initial_group_count = static_cast<unsigned>(group_main_state.size());
+    std::vector<unsigned> group_first(initial_group_count + 1, 0), group_end, group_marked_end;
+    std::vector<unsigned> group_states(state_count + 1), state_pos(state_count + 1);
+    state_group.push_back(initial_group_count);  // Sink group
+    for (unsigned state = 0; state <= state_count; ++state) {
+        if (state_group[state] < initial_group_count) { ++group_first[state_group[state] + 1]; }
+    }
+    for (unsigned group = 1; group <= initial_group_count; ++group) { group_first[group] += group_first[group - 1]; }
+    group_end = group_first, group_marked_end = group_first;
+    for (unsigned state = 0; state <= state_count; ++state) {
+        state_pos[state] = group_end[state_group[state]]++;
+        group_states[state_pos[state]] = state;
+    }
 
-    logger::info(file_name_).println(" - state group count: {}", group_count);
+    std::vector<unsigned> pending_groups(initial_group_count + 1);
+    std::iota(pending_groups.begin(), pending_groups.end(), 0);
+    std::vector<unsigned> splitter, preds, touched_groups;
+    std::uint64_t splitter_count = 0;
+    while (!pending_groups.empty()) {
+        unsigned group = pending_groups.back();
+        pending_groups.pop_back();
+        ++splitter_count;
+        splitter.assign(group_states.begin() + group_first[group], group_states.begin() + group_end[group]);
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            preds.clear();
+            for (unsigned state : splitter) {
+                unsigned key = state * meta_count_ + meta;
+                preds.insert(preds.end(), inv_states.begin() + inv_first[key], inv_states.begin() + inv_first[key + 1]);
+            }
 
-    auto is_dead_group = [&state_group, &group_main_state, meta_count = meta_count_, &Dtran = Dtran_,
-                          &accept = accept_](unsigned group) {
-        std::vector<bool> is_visited(group_main_state.size(), false);
-        std::vector<unsigned> group_stack;
-        group_stack.reserve(group_main_state.size());
-        group_stack.push_back(group);
-        is_visited[group] = true;
-        do {
-            group = group_stack.back();
-            group_stack.pop_back();
-            const auto& T = Dtran[group_main_state[group]];
-            for (unsigned meta = 0; meta < meta_count; ++meta) {  // Add adjucent groups
-                int next = T[meta];
-                if (next < 0) { continue; }
-                if (accept[next] > 0) { return false; }  // Can lead to accepting state
-                unsigned next_group = state_group[next];
-                if (!is_visited[next_group]) {
-                    group_stack.push_back(next_group);
-                    is_visited[next_group] = true;
-                }
+            // Mark predecessors moving them to the beginnings of their groups
+            for (unsigned state : preds) {
+                unsigned pred_group = state_group[state];
+                if (group_marked_end[pred_group] == group_first[pred_group]) { touched_groups.push_back(pred_group); }
+                unsigned pos = state_pos[state], marked_pos = group_marked_end[pred_group]++;
+                std::swap(group_states[pos], group_states[marked_pos]);
+                state_pos[group_states[pos]] = pos, state_pos[state] = marked_pos;
             }
-        } while (!group_stack.empty());
-        return true;
-    };
 
-    // Delete `dead` groups
-    unsigned dead_group_count = 0;
-    for (unsigned group = start_state_count_; group < group_main_state.size(); ++group) {
-        if (group_main_state[group] >= 0 && accept_[group_main_state[group]] == 0 && is_dead_group(group)) {
-            group_main_state[group] = -1;  // Mark state group as unused
-            ++dead_group_count;
+            // Split partially marked groups: the smaller part becomes a new group, which is to be a splitter too
+            for (unsigned touched_group : touched_groups) {
+                unsigned first = group_first[touched_group], marked_end = group_marked_end[touched_group];
+                group_marked_end[touched_group] = first;
+                if (marked_end == group_end[touched_group]) { continue; }
+                unsigned new_group = static_cast<unsigned>(group_first.size());
+                if (marked_end - first <= group_end[touched_group] - marked_end) {
+                    group_first.push_back(first), group_end.push_back(marked_end);
+                    group_first[touched_group] = group_marked_end[touched_group] = marked_end;
+                } else {
+                    group_first.push_back(marked_end), group_end.push_back(group_end[touched_group]);
+                    group_end[touched_group] = marked_end;
+                }
+                group_marked_end.push_back(group_first.back());
+                for (unsigned pos = group_first.back(); pos < group_end.back(); ++pos) {
+                    state_group[group_states[pos]] = new_group;
+                }
+                pending_groups.push_back(new_group);
+            }
+            touched_groups.clear();
         }
     }
 
-    logger::info(file_name_).println(" - dead group count: {}", dead_group_count);
-
-    auto get_main_state = [&state_group, &group_main_state](unsigned state) {
-        return group_main_state[state_group[state]];
-    };
+    // Renumber groups in order of their first states, which become main states
+    std::vector<int> group_order(group_first.size(), -1);
+    group_main_state.clear();
+    state_group.pop_back();
+    for (unsigned state = 0; state < state_count; ++state) {
+        unsigned& group = state_group[state];
+        if (group_order[group] < 0) {
+            group_order[group] = static_cast<int>(group_main_state.size());
+            group_main_state.push_back(state);
+        }
+        group = group_order[group];
+    }
 
-    auto is_used_state = [&get_main_state](unsigned state) { return get_main_state(state) == static_cast<int>(state); };
+    if (time_report_) { time_report_->addCounter("refinement splitters", splitter_count); }
+    logger::info(file_name_).println(" - state group count: {}", group_main_state.size());
 
     // Select new main states
     unsigned new_state_count = 0;
     std::vector<int> new_state_indices(Dtran_.size());
     for (unsigned state = 0; state < Dtran_.size(); ++state) {
-        new_state_indices[state] = is_used_state(state) ? new_state_count++ : -1;
+        new_state_indices[state] = group_main_state[state_group[state]] == state ? new_state_count++ : -1;
     }
 
     // Build optimized DFA table
     for (unsigned state = 0; state < Dtran_.size(); ++state) {
         if (int new_state_idx = new_state_indices[state]; new_state_idx >= 0) {
             for (unsigned meta = 0; meta < meta_count_; ++meta) {
-                int next = Dtran_[state][meta] >= 0 ? get_main_state(Dtran_[state][meta]) : -1;
-                Dtran_[new_state_idx][meta] = next >= 0 ? new_state_indices[next] : -1;
+                int next = Dtran_[state][meta];
+                Dtran_[new_state_idx][meta] = next >= 0 ? new_state_indices[group_main_state[state_group[next]]] : -1;
             }
             accept_[new_state_idx] = accept_[state];
             lls_[new_state_idx] = lls_[state];
@@ -311,9 +558,73 @@ void DfaBuilder::optimize() {
     accept_.resize(new_state_count);
     lls_.resize(new_state_count);
 
+    logger::info(file_name_).println(" - dead group count: {}", removeDeadStates());
     logger::info(file_name_).println(" - new state count: {}", Dtran_.size());
 }
 
+unsigned DfaBuilder::removeDeadStates() {
+    unsigned state_count = static_cast<unsigned>(Dtran_.size());
+
+    // Build inverse transition graph: `preds[pred_first[state]...]` are the states having transitions to `state`
+    std::vector<unsigned> pred_first(state_count + 1, 0), preds;
+    for (unsigned state = 0; state < state_count; ++state) {
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            if (int next = Dtran_[state][meta]; next >= 0) { ++pred_first[next]; }
+        }
+    }
+    for (unsigned state = 1; state <= state_count; ++state) { pred_first[state] += pred_first[state - 1]; }
+    preds.resize(pred_first[state_count]);
+    for (unsigned state = state_count; state > 0; --state) {
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            if (int next = Dtran_[state - 1][meta]; next >= 0) { preds[--pred_first[next]] = state - 1; }
+        }
+    }
+
+    // Walk backwards from accepting states: a state is alive if it can lead to an accepting state
+    std::vector<bool> is_alive(state_count, false);
+    std::vector<unsigned> pending_states;
+    pending_states.reserve(state_count);
+    for (unsigned state = 0; state < state_count; ++state) {
+        if (accept_[state] > 0) {
+            is_alive[state] = true;
+            pending_states.push_back(state);
+        }
+    }
+    while (!pending_states.empty()) {
+        unsigned state = pending_states.back();
+        pending_states.pop_back();
+        for (unsigned n = pred_first[state]; n < pred_first[state + 1]; ++n) {
+            if (!is_alive[preds[n]]) {
+                is_alive[preds[n]] = true;
+                pending_states.push_back(preds[n]);
+            }
+        }
+    }
+
+    // Delete dead states, but keep start states
+    unsigned new_state_count = 0;
+    std::vector<int> new_state_indices(state_count);
+    for (unsigned state = 0; state < state_count; ++state) {
+        new_state_indices[state] = state < start_state_count_ || is_alive[state] ? new_state_count++ : -1;
+    }
+    if (new_state_count == state_count) { return 0; }
+
+    for (unsigned state = 0; state < state_count; ++state) {
+        if (int new_state_idx = new_state_indices[state]; new_state_idx >= 0) {
+            for (unsigned meta = 0; meta < meta_count_; ++meta) {
+                int next = Dtran_[state][meta];
+                Dtran_[new_state_idx][meta] = next >= 0 ? new_state_indices[next] : -1;
+            }
+            accept_[new_state_idx] = accept_[state];
+            lls_[new_state_idx] = std::move(lls_[state]);
+        }
+    }
+    Dtran_.resize(new_state_count);
+    accept_.resize(new_state_count);
+    lls_.resize(new_state_count);
+    return state_count - new_state_count;
+}
+
 void DfaBuilder::makeCompressedDtran(std::vector<int>& def, std::vector<int>& base, std::vector<int>& next,
                                      std::vector<int>& check) const {
     assert(!Dtran_.empty());
@@ -343,29 +654,129 @@ void DfaBuilder::makeCompressedDtran(std::vector<int>& def, std::vector<int>& ba
         return !diffs.empty() ? calc_diffs_weight(diffs) : 0u;
     };
 
+    unsigned state_count = static_cast<unsigned>(Dtran_.size());
+
+    // Only states having at least one common transition can be better defaults than `all-failed` state, so
+    // index transitions: `states_by_tran[tran_first[next * meta_count_ + meta]...]` are the states having
+    // transition to `next` by `meta` in ascending order
+    std::vector<unsigned> tran_first(state_count * meta_count_ + 1, 0), states_by_tran;
+    std::vector<unsigned> tran_count(state_count, 0);
+    for (unsigned state = 0; state < state_count; ++state) {
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            if (int next = Dtran_[state][meta]; next >= 0) {
+                ++tran_first[next * meta_count_ + meta], ++tran_count[state];
+            }
+        }
+    }
+    for (unsigned n = 1; n < tran_first.size(); ++n) { tran_first[n] += tran_first[n - 1]; }
+    states_by_tran.resize(tran_first.back());
+    for (unsigned state = state_count; state > 0; --state) {
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            if (int next = Dtran_[state - 1][meta]; next >= 0) {
+                states_by_tran[--tran_first[next * meta_count_ + meta]] = state - 1;
+            }
+        }
+    }
+
+    // Already processed states of each transition list
+    std::vector<unsigned> tran_processed(tran_first.begin(), tran_first.end() - 1);
+
+    // Rows by their hashes to find equal states at once
+    std::unordered_multimap<std::size_t, unsigned> row_states;
+    row_states.reserve(state_count);
+    auto calc_row_hash = [meta_count = meta_count_](const auto& T) {
+        std::size_t h = 0;
+        for (unsigned meta = 0; meta < meta_count; ++meta) {
+            h ^= std::hash<int>{}(T[meta]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    };
+
+    // `free_cells[l]` leads to the nearest free cell not before `l`
+    std::vector<unsigned> free_cells;
+    auto find_free_cell = [&free_cells](unsigned l) {
+        unsigned free_l = l;
+        while (free_l < free_cells.size() && free_cells[free_l] != free_l) { free_l = free_cells[free_l]; }
+        while (l != free_l) { l = std::exchange(free_cells[l], free_l); }
+        return free_l;
+    };
+
     unsigned first_free = 0;
-    std::vector<unsigned> diffs;
+    std::uint64_t compare_count = 0, probe_count = 0;
+    std::vector<unsigned> diffs, common_count(state_count, 0), candidates;
+    std::vector<unsigned> def_depth(state_count, 0);  // Default chain lengths, each adds a probe at run time
     diffs.reserve(meta_count_);
 
-    for (unsigned state = 0; state < Dtran_.size(); ++state) {
-        const auto& T = Dtran_[state];
+    for (unsigned state = 0; state < state_count; ++state) {
+        auto T = Dtran_[state];
 
         // Find similar state minimizing `diffs` weight
         int sim_state = -1;
         unsigned min_weight = compare_with_all_failed_state(T, diffs);
+        std::size_t row_hash = calc_row_hash(T);
         if (min_weight > 0) {
-            for (unsigned state2 = 0; state2 < state; ++state2) {
-                unsigned weight = compare_states(T, Dtran_[state2], diffs);
-                if (weight < min_weight) {
-                    sim_state = state2;
-                    if (weight == 0) { break; }
-                    min_weight = weight;
+            auto [it, it_end] = row_states.equal_range(row_hash);
+            while (it != it_end && compare_states(T, Dtran_[it->second], diffs) > 0) { ++it; }
+            if (it != it_end) {  // Equal state is found
+                sim_state = it->second, min_weight = 0;
+            } else {
+                // Count common transitions with recently processed states
+                for (unsigned meta = 0; meta < meta_count_; ++meta) {
+                    if (T[meta] < 0) { continue; }
+                    unsigned key = T[meta] * meta_count_ + meta, first = tran_first[key];
+                    if (tran_processed[key] - first > kMaxTranScanLength) {
+                        first = tran_processed[key] - kMaxTranScanLength;
+                    }
+                    for (unsigned n = first; n < tran_processed[key]; ++n) {
+                        if (!common_count[states_by_tran[n]]++) { candidates.push_back(states_by_tran[n]); }
+                    }
+                }
+
+                // Select the most promising candidates: a state having `tran_count` transitions and
+                // `common_count` of them common with this state differs at most in the remaining ones
+                auto estimate = [&tran_count, &common_count, count = tran_count[state]](unsigned state2) {
+                    return count + tran_count[state2] - 2 * common_count[state2];
+                };
+                if (candidates.size() > kMaxSimilarCandidates) {
+                    std::nth_element(candidates.begin(), candidates.begin() + kMaxSimilarCandidates,
+                                     candidates.end(), [&estimate, &def_depth](unsigned state1, unsigned state2) {
+                                         return std::make_tuple(estimate(state1), def_depth[state1], state1) <
+                                                std::make_tuple(estimate(state2), def_depth[state2], state2);
+                                     });
+                }
+                for (unsigned state2 : candidates) { common_count[state2] = 0; }
+                candidates.resize(std::min<std::size_t>(candidates.size(), kMaxSimilarCandidates));
+                std::sort(candidates.begin(), candidates.end());
+                compare_count += candidates.size();
+                for (unsigned state2 : candidates) {
+                    // Of equally similar states the one with the shortest default chain is preferred
+                    unsigned weight = compare_states(T, Dtran_[state2], diffs);
+                    if (weight < min_weight ||
+                        (weight == min_weight && sim_state >= 0 && def_depth[state2] < def_depth[sim_state])) {
+                        sim_state = state2, min_weight = weight;
+                    }
+                }
+                candidates.clear();
+
+                // Defaults of the found state are often equally similar, but can be out of the scan window
+                for (int state2 = sim_state >= 0 ? def[sim_state] : -1; state2 >= 0; state2 = def[state2]) {
+                    ++compare_count;
+                    if (unsigned weight = compare_states(T, Dtran_[state2], diffs); weight <= min_weight) {
+                        sim_state = state2, min_weight = weight;
+                    }
                 }
             }
         }
 
+        // Register this state as processed, only the first of equal states is added to `row_states`
+        if (min_weight > 0) { row_states.emplace(row_hash, state); }
+        for (unsigned meta = 0; meta < meta_count_; ++meta) {
+            if (T[meta] >= 0) { ++tran_processed[T[meta] * meta_count_ + meta]; }
+        }
+
         // Save default state
         def[state] = sim_state;
+        if (sim_state >= 0) { def_depth[state] = def_depth[sim_state] + 1; }
 
         // Restore `diffs` vector
         if (sim_state >= 0) {  // `all-failed` is default state
@@ -374,20 +785,19 @@ void DfaBuilder::makeCompressedDtran(std::vector<int>& def, std::vector<int>& ba
             compare_with_all_failed_state(T, diffs);
         }
 
+        // Find unused space: skip the offsets, which lead to busy cells
         unsigned base_offset = first_free;
         if (!diffs.empty()) {
-            auto base_offset_fits = [&diffs, &check](unsigned offset) {
-                for (unsigned meta : diffs) {
-                    unsigned l = offset + meta;
-                    if (l >= check.size()) { break; }
-                    if (check[l] >= 0) { return false; }
-                }
-                return true;
-            };
-
-            // Find unused space
             base_offset = first_free > diffs[0] ? first_free - diffs[0] : 0;
-            while (base_offset < check.size() && !base_offset_fits(base_offset)) { ++base_offset; }
+            for (auto it = diffs.begin(); it != diffs.end(); ++probe_count) {
+                unsigned l = base_offset + *it, free_l = find_free_cell(l);
+                if (free_l != l) {
+                    base_offset = free_l - *it;
+                    it = diffs.begin();
+                } else {
+                    ++it;
+                }
+            }
         }
 
         // Save compressed table base offset
@@ -395,17 +805,26 @@ void DfaBuilder::makeCompressedDtran(std::vector<int>& def, std::vector<int>& ba
 
         // Append compressed table
         unsigned upper_bound = base_offset + meta_count_;
-        if (upper_bound > check.size()) { check.resize(upper_bound, -1); }
+        if (upper_bound > check.size()) {
+            for (unsigned l = static_cast<unsigned>(check.size()); l < upper_bound; ++l) { free_cells.push_back(l); }
+            check.resize(upper_bound, -1);
+        }
 
         // Save compressed state
         next.resize(check.size());
         for (unsigned meta : diffs) {
             unsigned l = base_offset + meta;
             next[l] = Dtran_[state][meta], check[l] = state;
+            free_cells[l] = l + 1;
         }
 
         // Move to the nearest free cell
-        while (first_free < check.size() && check[first_free] >= 0) { ++first_free; }
+        first_free = find_free_cell(first_free);
+    }
+
+    if (time_report_) {
+        time_report_->addCounter("default candidate comparisons", compare_count);
+        time_report_->addCounter("packing probes", probe_count);
     }
 
     // Fill free next & check cells
@@ -2,47 +2,91 @@
 
 #include "node.h"
 
+#include <algorithm>
 #include <list>
+#include <span>
 #include <string>
 
+class TimeReport;
+
+// DFA transition table: a row of `width` state indices for each state, -1 means no transition
+class DtranTable {
+ public:
+    DtranTable() = default;
+    explicit DtranTable(unsigned width) : width_(width) {}
+
+    unsigned getWidth() const { return width_; }
+    std::size_t size() const { return width_ ? data_.size() / width_ : 0; }
+    bool empty() const { return data_.empty(); }
+    std::span<int> operator[](std::size_t state) { return {data_.data() + state * width_, width_}; }
+    std::span<const int> operator[](std::size_t state) const { return {data_.data() + state * width_, width_}; }
+
+    void reserve(std::size_t count) { data_.reserve(count * width_); }
+    void resize(std::size_t count) { data_.resize(count * width_, -1); }
+
+    // Keeps only the first `width` columns
+    void setWidth(unsigned width) {
+        assert(width <= width_);
+        for (std::size_t state = 1; state < size(); ++state) {
+            std::copy_n(data_.begin() + state * width_, width, data_.begin() + state * width);
+        }
+        data_.resize(size() * width);
+        data_.shrink_to_fit();
+        width_ = width;
+    }
+
+ private:
+    unsigned width_ = 0;
+    std::vector<int> data_;
+};
+
 // DFA builder class
 class DfaBuilder {
  public:
     static const unsigned kSymbCount = 256;
     static const unsigned kCountWeight = 1;
     static const unsigned kSegSizeWeight = 1;
+    static const unsigned kMaxTranScanLength = 64;
+    static const unsigned kMaxSimilarCandidates = 16;
 
     explicit DfaBuilder(std::string file_name) : file_name_(std::move(file_name)) {}
 
-    void addPattern(std::unique_ptr<Node> syn_tree, unsigned n_pat, const ValueSet& sc);
-    bool isPatternWithTrailingContext(unsigned n_pat) const;
+    void addPattern(const Node* syn_tree, unsigned n_pat, const ValueSet& sc);  // Note: `syn_tree` is not copied
+    bool isPatternWithTrailingContext(unsigned n_pat) const { return trailing_context_patterns_.contains(n_pat); }
     bool hasPatternsWithLeftNlAnchoring() const;
-    void build(unsigned sc_count,     // Start condition count
-               bool case_insensitive  // Case insensitive DFA?
+    void build(unsigned sc_count,          // Start condition count
+               bool case_insensitive,      // Case insensitive DFA?
+               unsigned thread_count = 1   // Thread count for subset construction
     );
     void optimize();
     unsigned getMetaCount() const { return meta_count_; }
     const std::vector<int>& getSymb2Meta() const { return symb2meta_; }
-    const std::vector<std::array<int, kSymbCount>>& getDtran() const { return Dtran_; }
+    const DtranTable& getDtran() const { return Dtran_; }
     const std::vector<int>& getAccept() const { return accept_; }
     const std::vector<ValueSet>& getLLS() const { return lls_; }
     void makeCompressedDtran(std::vector<int>& def, std::vector<int>& base, std::vector<int>& next,
                              std::vector<int>& check) const;
+    void setTimeReport(TimeReport* report) { time_report_ = report; }
 
  protected:
     struct Pattern {
-        Pattern(const ValueSet& in_sc, std::unique_ptr<Node> in_syn_tree)
-            : sc(in_sc), syn_tree(std::move(in_syn_tree)) {}
+        Pattern(const ValueSet& in_sc, const Node* in_syn_tree) : sc(in_sc), syn_tree(in_syn_tree) {}
         ValueSet sc;
-        std::unique_ptr<Node> syn_tree;
+        const Node* syn_tree;
+        ValueSet firstpos;  // Calculated by `build()`
     };
 
+    unsigned removeDeadStates();  // Removes states, which cannot lead to accepting states
+
     std::string file_name_;
     unsigned start_state_count_ = 0;
     unsigned meta_count_ = 0;
+    NodePool node_pool_;
     std::list<Pattern> patterns_;
+    ValueSet trailing_context_patterns_;
     std::vector<int> symb2meta_;
-    std::vector<std::array<int, kSymbCount>> Dtran_;
+    DtranTable Dtran_;
     std::vector<int> accept_;
     std::vector<ValueSet> lls_;
+    TimeReport* time_report_ = nullptr;
 };
@@ -0,0 +1,64 @@
+#include "dfa_image.h"
+
+#include "dfa_builder.h"
+#include "file_util.h"
+
+#include <lexegen/image.h>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+// Appends the table aligned to the cache line and returns its offset
+template<typename Ty>
+std::uint32_t appendTable(std::string& image, const std::vector<Ty>& table) {
+    image.resize((image.size() + lexegen::image_alignment - 1) & ~std::size_t(lexegen::image_alignment - 1));
+    const auto offset = static_cast<std::uint32_t>(image.size());
+    image.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Ty));
+    return offset;
+}
+}  // namespace
+
+bool writeDfaImage(const std::string& file_name, const DfaBuilder& dfa_builder, const std::vector<int>& def,
+                   const std::vector<int>& base, const std::vector<int>& next, const std::vector<int>& check,
+                   const std::vector<int>& accept, bool has_trailing_context, bool has_left_nl_anchoring) {
+    static_assert(sizeof(int) == sizeof(std::int32_t));
+    const auto& symb2meta_data = dfa_builder.getSymb2Meta();
+    std::vector<std::uint8_t> symb2meta(symb2meta_data.begin(), symb2meta_data.end());
+
+    std::vector<int> lls_idx, lls_list;
+    if (has_trailing_context) {
+        const auto& lls = dfa_builder.getLLS();
+        lls_idx.reserve(lls.size() + 1);
+        lls_idx.push_back(0);
+        for (const auto& pat_set : lls) {
+            for (unsigned n_pat : pat_set) { lls_list.push_back(n_pat); }
+            lls_idx.push_back(static_cast<int>(lls_list.size()));
+        }
+    }
+
+    lexegen::image_header header{};
+    header.magic = lexegen::image_magic;
+    header.version = lexegen::image_version;
+    if (has_trailing_context) { header.flags |= lexegen::image_flag_has_trailing_context; }
+    if (has_left_nl_anchoring) { header.flags |= lexegen::image_flag_has_left_nl_anchoring; }
+    header.state_count = static_cast<std::uint32_t>(accept.size());
+    header.transition_count = static_cast<std::uint32_t>(next.size());
+    header.lls_list_size = static_cast<std::uint32_t>(lls_list.size());
+
+    std::string image(sizeof(header), '\0');
+    header.symb2meta_offset = appendTable(image, symb2meta);
+    header.def_offset = appendTable(image, def);
+    header.base_offset = appendTable(image, base);
+    header.next_offset = appendTable(image, next);
+    header.check_offset = appendTable(image, check);
+    header.accept_offset = appendTable(image, accept);
+    if (has_trailing_context) {
+        header.lls_idx_offset = appendTable(image, lls_idx);
+        header.lls_list_offset = appendTable(image, lls_list);
+    }
+    if (image.size() > std::numeric_limits<std::uint32_t>::max()) { return false; }
+    header.image_size = static_cast<std::uint32_t>(image.size());
+    std::memcpy(image.data(), &header, sizeof(header));
+    return writeFile(file_name, image);
+}
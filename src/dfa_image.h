@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class DfaBuilder;
+
+// Writes the DFA image for `lexegen::dfa_image` runtime (see `include/lexegen/image.h`): transition tables are
+// made by `DfaBuilder::makeCompressedDtran()`, `accept` table must already have the trailing context flags if they are
+// used
+bool writeDfaImage(const std::string& file_name, const DfaBuilder& dfa_builder, const std::vector<int>& def,
+                   const std::vector<int>& base, const std::vector<int>& next, const std::vector<int>& check,
+                   const std::vector<int>& accept, bool has_trailing_context, bool has_left_nl_anchoring);
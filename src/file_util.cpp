@@ -0,0 +1,22 @@
+#include "file_util.h"
+
+#include <uxs/algorithm.h>
+#include <uxs/io/filebuf.h>
+
+bool readFile(const std::string& file_name, std::string& text) {
+    uxs::filebuf ifile(file_name.c_str(), "r");
+    if (!ifile) { return false; }
+    auto pos = ifile.seek(0, uxs::seekdir::end);
+    if (pos == uxs::iobuf::traits_type::npos()) { return false; }
+    text.resize(static_cast<std::size_t>(pos));
+    ifile.seek(0);
+    text.resize(ifile.read(est::as_span(text.data(), text.size())));
+    return true;
+}
+
+bool writeFile(const std::string& file_name, std::string_view text) {
+    uxs::filebuf ofile(file_name.c_str(), "w");
+    if (!ofile) { return false; }
+    ofile.write(text);
+    return true;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+bool readFile(const std::string& file_name, std::string& text);
+bool writeFile(const std::string& file_name, std::string_view text);
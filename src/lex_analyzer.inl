@@ -1,68 +1,72 @@
 /* Lexegen autogenerated analyzer file - do not edit! */
 /* clang-format off */
 
-static uint8_t symb2meta[256] = {
+static const uint8_t symb2meta[256] = {
     0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 3, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 4, 5, 6, 4, 7, 1,
     1, 4, 4, 4, 4, 1, 8, 9, 4, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 12, 1, 13, 1, 14, 4, 1, 15, 15, 15, 15, 15, 15,
     16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 18, 19, 20, 16, 1, 21, 22, 15,
-    15, 15, 23, 16, 16, 24, 16, 16, 16, 16, 25, 26, 27, 16, 28, 29, 30, 16, 31, 16, 32, 16, 16, 33, 4, 34, 1, 1, 1, 1,
+    15, 15, 23, 16, 16, 24, 16, 16, 16, 16, 25, 26, 27, 16, 28, 29, 30, 31, 32, 16, 33, 16, 16, 34, 4, 35, 1, 1, 1, 1,
     1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
     1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
     1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
     1, 1, 1, 1, 1, 1, 1, 1, 1
 };
 
-static int def[67] = {
+static const int8_t def[76] = {
     -1, -1, 0, 1, 0, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, 12, 12, 33, -1, -1, -1, 3, -1, -1, -1, 14, -1, -1, 45, -1, -1, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1
+    -1, -1, -1, 32, -1, 32, 32, 32, -1, -1, -1, -1, 12, 12, 42, -1, -1, -1, 3, -1, -1, -1, 14, -1, -1, 54, -1, -1, 1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
 };
 
-static int base[67] = {
-    0, 34, 68, 102, 134, 57, 0, 70, 0, 0, 0, 0, 165, 53, 197, 217, 135, 0, 0, 78, 0, 0, 0, 0, 0, 0, 0, 161, 240, 0, 95,
-    0, 0, 118, 137, 124, 0, 132, 0, 249, 0, 0, 132, 0, 0, 249, 142, 151, 0, 251, 0, 0, 0, 275, 284, 0, 146, 144, 154,
-    149, 148, 0, 149, 161, 174, 209, 0
+static const uint16_t base[76] = {
+    0, 35, 70, 105, 138, 59, 0, 72, 0, 0, 0, 0, 170, 55, 203, 224, 139, 0, 0, 80, 0, 0, 0, 0, 0, 0, 74, 0, 166, 248, 0,
+    251, 265, 268, 0, 282, 291, 300, 88, 132, 0, 0, 141, 306, 132, 0, 137, 0, 316, 0, 0, 139, 0, 0, 315, 145, 133, 0,
+    291, 0, 0, 0, 300, 339, 0, 131, 145, 157, 151, 150, 0, 152, 159, 158, 165, 0
 };
 
-static int next[319] = {
-    -1, 9, 7, 51, 9, 10, 52, 53, 9, 9, 37, 37, 9, 9, 9, 54, 54, 9, 9, 9, 9, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54,
-    54, 9, 9, 49, 49, 40, 49, 50, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 43, 49, 49, 49, 49, 49, 49, 49, 49,
-    49, 49, 49, 49, 49, 49, 49, 49, 6, 12, 8, 7, 32, 6, 6, 6, 11, 6, 6, 6, 6, 6, 6, 6, 13, 14, 6, 30, 6, 6, 6, 6, 6, 6,
-    6, 6, 6, 6, 6, 6, 15, 6, 39, 39, 31, 39, 39, 39, 39, 41, 39, 39, 39, 39, 39, 39, 39, 39, 42, -1, 44, 39, 39, 39, 39,
-    39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 8, 36, 35, 9, 9, 37, 37, 45, 16, 16, 34, 34, 9, 9, 36, 46, 46, 47, 9, 9,
-    9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 33, 38, 17, 48, 28, 28, 62, 58, 59, 28, 60, 61, 63, 34, 34, 28, 28, 28, 64, 34, 34,
-    34, 34, 34, 34, 34, 34, 34, 34, 34, 34, 18, 18, 65, 18, 18, 18, 18, 18, 18, 19, 18, 18, 18, 18, 18, 18, 18, 18, 18,
-    18, 20, 21, 22, 18, 23, 18, 18, 24, 18, 25, 26, 27, 18, 18, 16, 16, 66, -1, -1, -1, 16, 16, 16, 16, 16, 16, 16, 16,
-    16, 16, 16, 16, 29, 29, -1, -1, -1, 29, -1, -1, -1, -1, -1, 29, 29, 29, 46, 46, -1, -1, -1, -1, 46, 46, 46, 46, 46,
-    46, 46, 46, 46, 46, 46, 46, 55, 39, 49, 49, -1, -1, -1, -1, -1, -1, -1, -1, 54, 54, -1, -1, -1, 54, 54, 56, -1, -1,
-    57, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, -1, -1
+static const int8_t next[375] = {
+    -1, 9, 7, 60, 9, 10, 61, 62, 9, 9, 46, 46, 9, 9, 9, 63, 63, 9, 9, 9, 9, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 9, 9, 58, 58, 49, 58, 59, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 52, 58, 58, 58, 58, 58, 58, 58,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 6, 12, 8, 7, 41, 6, 6, 6, 11, 6, 6, 6, 6, 6, 6, 6, 13, 14, 6, 39, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 15, 6, 48, 48, 31, 48, 48, 48, 48, 50, 48, 48, 48, 48, 48, 48, 48, 48, 51, 34, 53, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 8, 40, -1, 9, 9, 45, 46, 46, 16, 16, 54, 57, 9, 9, 55,
+    55, 56, 71, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 42, 47, 17, 67, 29, 29, 68, 69, 70, 29, 72, 73, 74, 43, 43, 29,
+    29, 29, 75, 43, 43, 43, 43, 43, 43, 43, 43, 43, 43, 43, 43, 43, 18, 18, -1, 18, 18, 18, 18, 18, 18, 19, 18, 18, 18,
+    18, 18, 18, 18, 18, 18, 18, 20, 21, 22, 18, 23, 18, 18, 24, 18, 25, 26, 27, 28, 18, 18, 16, 16, -1, -1, -1, -1, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 30, 30, -1, 32, 32, 30, -1, -1, 32, -1, -1, 30, 30, 30, 32, 32, 32,
+    33, 33, -1, 35, 35, 33, -1, -1, 35, -1, -1, 33, 33, 33, 35, 35, 35, 36, 36, -1, -1, -1, 36, -1, -1, 34, 37, 37, 36,
+    36, 36, 37, 64, 44, -1, 38, 38, 37, 37, 37, 38, 43, 43, -1, -1, 45, 38, 38, 38, -1, -1, 65, -1, -1, 66, 55, 55, -1,
+    -1, -1, -1, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 63, 63, 48, -1, -1, 63, 63, -1, -1, -1, -1, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, -1, -1
 };
 
-static int check[319] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 5, 2, 7, 13, 2, 2, 2,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 19, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 30, 3, 3, 3, 3, 3, 3, 3, 3, 3,
-    3, 3, 3, 3, 3, 33, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 35, 34, 4, 4, 37, 37, 42, 16, 16, 34, 34, 4,
-    4, 34, 46, 46, 46, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 12, 4, 16, 47, 27, 27, 56, 57, 58, 27, 59, 60, 62, 12, 12,
-    27, 27, 27, 63, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 14, 14, 64, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
-    14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 65, 15, 15, 15, 15, 15,
-    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 28, 28, 39, 28, 49, 28, 49, 39, 28, 28, 28, 28, 28, 28, 45, 45, 39, 39, 39,
-    49, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 53, 39, 49, 49, 53, 53, 53, 53, 53, 53, 53, 53, 54, 54, 53, 53,
-    53, 54, 54, 53, 53, 53, 53, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54
+static const uint8_t check[375] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 5, 2, 7, 13, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 19, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 26, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 38, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 39, 42, 4, 4, 44, 46, 46, 16, 16,
+    51, 56, 4, 4, 55, 55, 55, 65, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 12, 4, 16, 66, 28, 28, 67, 68, 69, 28, 71, 72,
+    73, 12, 12, 28, 28, 28, 74, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+    14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 29, 29, 29, 31, 31, 29, 29, 29, 31, 29, 29, 29, 29,
+    29, 31, 31, 31, 32, 32, 29, 33, 33, 32, 29, 29, 33, 31, 31, 32, 32, 32, 33, 33, 33, 35, 35, 58, 32, 58, 35, 32, 32,
+    32, 36, 36, 35, 35, 35, 36, 62, 43, 58, 37, 37, 36, 36, 36, 37, 43, 43, 36, 48, 43, 37, 37, 37, 48, 36, 62, 37, 37,
+    62, 54, 54, 37, 48, 48, 48, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 54, 63, 63, 48, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
 };
 
-static int accept[67] = {
-    0, 0, 0, 0, 0, 0, 54, 38, 50, 72, 70, 44, 54, 40, 54, 48, 0, 46, 22, 4, 8, 10, 12, 16, 14, 18, 20, 22, 6, 6, 4, 4,
-    42, 0, 0, 0, 3, 64, 52, 28, 36, 30, 72, 72, 34, 0, 0, 0, 32, 24, 26, 68, 66, 72, 62, 60, 0, 0, 0, 0, 0, 56, 0, 0, 0,
-    0, 58
+static const uint8_t accept[76] = {
+    0, 0, 0, 0, 0, 0, 56, 40, 52, 74, 72, 46, 56, 42, 56, 50, 0, 48, 24, 4, 10, 12, 14, 18, 16, 20, 24, 22, 24, 6, 6, 0,
+    0, 0, 8, 0, 0, 0, 0, 4, 4, 44, 0, 0, 0, 3, 66, 54, 30, 38, 32, 74, 74, 36, 0, 0, 0, 34, 26, 28, 70, 68, 74, 64, 62,
+    0, 0, 0, 0, 0, 58, 0, 0, 0, 0, 60
 };
 
-static int lls_idx[68] = {
+static const uint8_t lls_idx[77] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
 };
 
-static int lls_list[1] = {
+static const uint8_t lls_list[1] = {
     1
 };
 
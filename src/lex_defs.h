@@ -12,6 +12,7 @@ enum {
     pat_sc_list_begin,
     pat_escape_oct,
     pat_escape_hex,
+    pat_escape_unicode,
     pat_escape_a,
     pat_escape_b,
     pat_escape_f,
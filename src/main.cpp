@@ -1,11 +1,20 @@
+#include "build_cache.h"
 #include "dfa_builder.h"
+#include "dfa_image.h"
+#include "file_util.h"
 #include "parser.h"
+#include "time_report.h"
 
 #include <uxs/algorithm.h>
 #include <uxs/cli/parser.h>
 #include <uxs/io/filebuf.h>
 
+#include <algorithm>
+#include <bitset>
 #include <exception>
+#include <optional>
+#include <span>
+#include <thread>
 
 #define XSTR(s) STR(s)
 #define STR(s)  #s
@@ -28,31 +37,297 @@ void outputData(uxs::iobuf& outp, Iter from, Iter to, std::size_t ntab = 0) {
 }
 
 template<typename Iter>
-void outputArray(uxs::iobuf& outp, std::string_view state_type, std::string_view array_name, Iter from, Iter to) {
-    uxs::print(outp, "\nstatic {} {}", state_type, array_name);
+void outputArray(uxs::iobuf& outp, std::string_view state_type, std::string_view array_name, Iter from, Iter to,
+                 std::string_view specifiers = "static const", std::size_t ntab = 0) {
+    const std::string tab(ntab, ' ');
+    uxs::print(outp, "\n{}{} {} {}", tab, specifiers, state_type, array_name);
     if (from == to) {
         uxs::print(outp, "[1] = {{ 0 }};\n");
     } else {
         uxs::print(outp, "[{}] = {{\n", std::distance(from, to));
-        outputData(outp, from, to, 4);
-        uxs::print(outp, "}};\n");
+        outputData(outp, from, to, ntab + 4);
+        uxs::print(outp, "{}}};\n", tab);
     }
 }
 
+// Returns the narrowest integer type, which can hold all values from [min, max] range, and its size
+std::pair<std::string_view, std::size_t> getNarrowestType(int min, int max) {
+    if (min >= 0 && max <= 0xff) { return {"uint8_t", 1}; }
+    if (min >= -0x80 && max <= 0x7f) { return {"int8_t", 1}; }
+    if (min >= 0 && max <= 0xffff) { return {"uint16_t", 2}; }
+    if (min >= -0x8000 && max <= 0x7fff) { return {"int16_t", 2}; }
+    return {"int", sizeof(int)};
+}
+
+template<typename Iter>
+std::pair<std::string_view, std::size_t> getNarrowestType(Iter from, Iter to) {
+    if (from == to) { return getNarrowestType(0, 0); }
+    const auto [min, max] = std::minmax_element(from, to);
+    return getNarrowestType(static_cast<int>(*min), static_cast<int>(*max));
+}
+
+template<typename Iter>
+void outputNarrowestArray(uxs::iobuf& outp, std::string_view array_name, Iter from, Iter to,
+                          std::string_view specifiers = "static const", std::size_t ntab = 0) {
+    outputArray(outp, getNarrowestType(from, to).first, array_name, from, to, specifiers, ntab);
+}
+
+// Outputs array of two-field records, each field has the narrowest type for its own values
+void outputNarrowestRecordArray(uxs::iobuf& outp, std::string_view array_name, std::string_view name1,
+                                const std::vector<int>& field1, std::string_view name2, const std::vector<int>& field2,
+                                std::string_view specifiers = "static const") {
+    std::vector<std::string> records;
+    records.reserve(field1.size());
+    for (std::size_t n = 0; n < field1.size(); ++n) {
+        records.push_back(uxs::format("{{{}, {}}}", field1[n], field2[n]));
+    }
+    const std::string record_type = uxs::format("struct {{ {} {}; {} {}; }}",
+                                                getNarrowestType(field1.begin(), field1.end()).first, name1,
+                                                getNarrowestType(field2.begin(), field2.end()).first, name2);
+    outputArray(outp, record_type, array_name, records.begin(), records.end(), specifiers);
+}
+
 struct EngineInfo {
     int compress_level = 2;
+    bool direct_coded = false;
+    bool template_traits = false;
+    bool stackless = false;
+    bool batch_api = false;
+    bool interleaved_tables = false;
     bool has_trailing_context = false;
     bool has_left_nl_anchoring = false;
     std::string_view state_type{"int"};
 };
 
-void outputLexEngine(uxs::iobuf& outp, const EngineInfo& info) {
+// Symbol sets, on which states loop to themselves: `skip_idx[state]` is 1-based index of the state's set or 0
+struct RunSkipInfo {
+    std::vector<unsigned> skip_idx;
+    std::vector<std::bitset<256>> sets;
+};
+
+RunSkipInfo findSelfLoopSets(const DfaBuilder& dfa_builder) {
+    const auto& Dtran = dfa_builder.getDtran();
+    const auto& symb2meta = dfa_builder.getSymb2Meta();
+    RunSkipInfo run_skip;
+    run_skip.skip_idx.resize(Dtran.size());
+    for (std::size_t state = 0; state < Dtran.size(); ++state) {
+        std::bitset<256> set;
+        for (unsigned symb = 0; symb < 256; ++symb) {
+            if (Dtran[state][symb2meta[symb]] == static_cast<int>(state)) { set.set(symb); }
+        }
+        if (set.none()) { continue; }
+        auto it = std::find(run_skip.sets.begin(), run_skip.sets.end(), set);
+        if (it == run_skip.sets.end()) { it = run_skip.sets.insert(it, set); }
+        run_skip.skip_idx[state] = 1 + static_cast<unsigned>(it - run_skip.sets.begin());
+    }
+    return run_skip;
+}
+
+void outputRunSkip(uxs::iobuf& outp, const EngineInfo& info, const std::bitset<256>& set, unsigned set_idx,
+                   std::string_view state, std::string_view indent) {
+    // Vectorized check is used if the set or its complement is a union of a few symbol ranges
+    const std::size_t max_range_count = 4;
+    auto get_ranges = [](const std::bitset<256>& set) {
+        std::vector<std::pair<unsigned, unsigned>> ranges;
+        for (unsigned symb = 0; symb < 256; ++symb) {
+            if (!set[symb]) { continue; }
+            if (ranges.empty() || ranges.back().second + 1 != symb) { ranges.emplace_back(symb, symb); }
+            ranges.back().second = symb;
+        }
+        return ranges;
+    };
+    auto ranges = get_ranges(set), complement_ranges = get_ranges(~set);
+    const bool use_complement = complement_ranges.size() < ranges.size();
+    if (use_complement) { ranges.swap(complement_ranges); }
+
+    auto output_advance = [&](std::string_view ind, unsigned count) {
+        if (info.stackless) {
+            uxs::print(outp, "{}first += {}, llen += {};\n", ind, count, count);
+            return;
+        }
+        uxs::print(outp, "{}for (i = 0; i < {}; ++i) {{ sptr[i] = {}; }}\n", ind, count, state);
+        uxs::print(outp, "{}sptr += {}, first += {};\n", ind, count, count);
+    };
+
+    uxs::print(outp, "{}/* Skip the run of symbols, on which the state loops to itself */\n", indent);
+    if (ranges.size() <= max_range_count) {
+        struct SimdInfo {
+            std::string_view macro, type, pfx, load, all_set;
+            unsigned width;
+        };
+        static constexpr SimdInfo simd_info[] = {
+            {"LEX_USE_AVX2", "__m256i", "_mm256_", "_mm256_loadu_si256((const __m256i*)first)", "-1", 32},
+            {"LEX_USE_SSE2", "__m128i", "_mm_", "_mm_loadu_si128((const __m128i*)first)", "0xffff", 16},
+        };
+        const bool has_wide_range = std::any_of(ranges.begin(), ranges.end(),
+                                                [](const auto& r) { return r.first != r.second; });
+        for (const auto& simd : simd_info) {
+            const std::string ind = std::string(indent) + "    ";
+            const std::string_view or_fn = simd.width == 32 ? "or_si256" : "or_si128";
+            uxs::print(outp, "#{} defined({})\n", &simd == simd_info ? "if" : "elif", simd.macro);
+            uxs::print(outp, "{}while (last - first >= {}) {{\n", indent, simd.width);
+            uxs::print(outp, "{}{} v = {}, {}m;\n", ind, simd.type, simd.load, has_wide_range ? "t, " : "");
+            if (!info.stackless) { uxs::print(outp, "{}int i;\n", ind); }
+            for (std::size_t n = 0; n < ranges.size(); ++n) {
+                const auto [lo, hi] = ranges[n];
+                std::string cmp;
+                if (lo == hi) {
+                    cmp = uxs::format("{0}cmpeq_epi8(v, {0}set1_epi8((char){1}))", simd.pfx, lo);
+                } else {
+                    uxs::print(outp, "{0}t = {1}sub_epi8(v, {1}set1_epi8((char){2}));\n", ind, simd.pfx, lo);
+                    cmp = uxs::format("{0}cmpeq_epi8({0}min_epu8(t, {0}set1_epi8((char){1})), t)", simd.pfx,
+                                      hi - lo);
+                }
+                if (n == 0) {
+                    uxs::print(outp, "{}m = {};\n", ind, cmp);
+                } else {
+                    uxs::print(outp, "{}m = {}{}(m, {});\n", ind, simd.pfx, or_fn, cmp);
+                }
+            }
+            uxs::print(outp, "{}if ({}movemask_epi8(m) != {}) {{ break; }}\n", ind, simd.pfx,
+                       use_complement ? "0" : simd.all_set);
+            output_advance(ind, simd.width);
+            uxs::print(outp, "{}}}\n", indent);
+        }
+        uxs::print(outp, "#endif\n");
+    }
+    uxs::print(outp, "{0}while (first != last && ((skip_sets[{1} + ({2} >> 3)] >> ({2} & 7)) & 1)) {{\n", indent,
+               32 * (set_idx - 1), "(unsigned char)*first");
+    if (info.stackless) {
+        uxs::print(outp, "{}    ++first, ++llen;\n", indent);
+    } else {
+        uxs::print(outp, "{}    *sptr++ = {}, ++first;\n", indent, state);
+    }
+    uxs::print(outp, "{}}}\n", indent);
+}
+
+void outputCaseLabels(uxs::iobuf& outp, const std::vector<unsigned>& symbols, std::string_view action) {
+    const unsigned length_limit = 120;
+    std::string line("       ");
+    for (unsigned symb : symbols) {
+        auto label = uxs::format(" case {}:", symb);
+        if (line.length() + label.length() > length_limit) {
+            outp.write(line).put('\n');
+            line = "       ";
+        }
+        line += label;
+    }
+    if (line.length() + action.length() + 1 > length_limit) {
+        outp.write(line).put('\n');
+        line = "       ";
+    }
+    outp.write(line).put(' ').write(action).put('\n');
+}
+
+void outputDirectCode(uxs::iobuf& outp, const EngineInfo& info, const DfaBuilder& dfa_builder,
+                      const RunSkipInfo& run_skip) {
+    const auto& Dtran = dfa_builder.getDtran();
+    const auto& symb2meta = dfa_builder.getSymb2Meta();
+    const auto& accept = dfa_builder.getAccept();
+    const bool use_meta = info.compress_level > 0;
+    const unsigned symb_count = use_meta ? dfa_builder.getMetaCount() : 256;
+    const std::string_view symb_expr = use_meta ? "symb2meta[(unsigned char)*first]" : "(unsigned char)*first";
+
+    // Only states with incoming transitions need labels, which consume the symbol
+    std::vector<bool> is_target(Dtran.size());
+    for (std::size_t state = 0; state < Dtran.size(); ++state) {
+        for (int next_state : Dtran[state]) {
+            if (next_state >= 0) { is_target[next_state] = true; }
+        }
+    }
+
+    uxs::print(outp, "    switch (state) {{ /* Jump to the current state */\n");
+    for (std::size_t state = 0; state < Dtran.size(); ++state) {
+        uxs::print(outp, "        case {0}: goto s{0};\n", state);
+    }
+    uxs::print(outp, "        default: goto unroll;\n");
+    uxs::print(outp, "    }}\n");
+
+    std::vector<std::pair<int, unsigned>> transitions(symb_count);
+    std::vector<std::pair<int, std::vector<unsigned>>> groups;
+    for (std::size_t state = 0; state < Dtran.size(); ++state) {
+        // Group symbols by target state, the most frequent target becomes the default branch
+        const auto row = Dtran[state];
+        for (unsigned symb = 0; symb < symb_count; ++symb) {
+            transitions[symb] = {row[use_meta ? symb : symb2meta[symb]], symb};
+        }
+        std::sort(transitions.begin(), transitions.end());
+        groups.clear();
+        for (const auto& [target, symb] : transitions) {
+            if (groups.empty() || groups.back().first != target) { groups.emplace_back().first = target; }
+            groups.back().second.push_back(symb);
+        }
+        auto default_group = std::max_element(groups.begin(), groups.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.size() < rhs.second.size();
+        });
+
+        // Accepting states without trailing context return the pattern immediately instead of unrolling, stackless
+        // engine remembers the last accepting state on the way forward, so it always returns it from `unroll`
+        const unsigned n_pat = accept[state];
+        const bool accept_at_once = !info.stackless && n_pat > 0 && !dfa_builder.isPatternWithTrailingContext(n_pat);
+        auto make_action = [&](int target) {
+            if (target >= 0) { return uxs::format("goto p{};", target); }
+            return accept_at_once ? uxs::format("goto a{};", state) : std::string("goto unroll;");
+        };
+
+        // Runs are skipped only after a transition, so the state is entered with at least one consumed symbol
+        auto output_run_skip = [&]() {
+            if (run_skip.skip_idx.empty() || !run_skip.skip_idx[state]) { return; }
+            const unsigned set_idx = run_skip.skip_idx[state];
+            outputRunSkip(outp, info, run_skip.sets[set_idx - 1], set_idx, uxs::to_string(state), "    ");
+        };
+
+        outp.put('\n');
+        if (info.stackless) {
+            if (is_target[state]) {
+                uxs::print(outp, "p{}: ++first, ++llen;\n", state);
+                output_run_skip();
+                if (n_pat > 0) { uxs::print(outp, "    n_pat = {}, accept_len = llen;\n", n_pat); }
+            }
+            uxs::print(outp, "s{0}: if (first == last) {{ state = {0}; goto end_of_input; }}\n", state);
+        } else {
+            if (is_target[state]) {
+                uxs::print(outp, "p{0}: *sptr++ = {0}, ++first;\n", state);
+                output_run_skip();
+            }
+            uxs::print(outp, "s{}: if (first == last) {{ goto end_of_input; }}\n", state);
+        }
+        uxs::print(outp, "    switch ({}) {{\n", symb_expr);
+        for (auto group = groups.begin(); group != groups.end(); ++group) {
+            if (group != default_group) { outputCaseLabels(outp, group->second, make_action(group->first)); }
+        }
+        uxs::print(outp, "        default: {}\n", make_action(default_group->first));
+        uxs::print(outp, "    }}\n");
+        if (accept_at_once) {
+            uxs::print(outp, "a{}: if (sptr == sptr0) {{ goto unroll; }}\n", state);
+            uxs::print(outp, "    *p_sptr = sptr0, *p_llen = (size_t)(sptr - sptr0);\n");
+            uxs::print(outp, "    return {};\n", n_pat);
+        }
+    }
+    if (!Dtran.empty()) { uxs::print(outp, "end_of_input:\n"); }
+}
+
+void outputLexEngine(uxs::iobuf& outp, const EngineInfo& info, const DfaBuilder& dfa_builder,
+                     const RunSkipInfo& run_skip) {
     static constexpr std::string_view text0[] = {
         "static int lex(const char* first, const char* last, {0}** p_sptr, size_t* p_llen, int flags) {{",
         "    {0}* sptr = *p_sptr;",
         "    {0}* sptr0 = sptr - *p_llen;",
         "    {0} state = {1};",
-        "    while (first != last) {{ /* Analyze till transition is impossible */",
+    };
+    static constexpr std::string_view text0_stackless[] = {
+        "static int lex(const char* first, const char* last, int** p_sptr, size_t* p_llen, int flags) {{",
+        "    int* sptr = *p_sptr;",
+        "    size_t llen = *p_llen, accept_len = 0;",
+        "    int n_pat = 0, state;",
+        "    if (llen) {{ /* Resume analysis suspended at the end of input buffer */",
+        "        state = *--sptr, accept_len = (size_t)*--sptr, n_pat = *--sptr;",
+        "    }} else {{",
+        "        state = {1};",
+        "    }}",
+    };
+    static constexpr std::string_view text0_loop[] = {
+        "    while (first != last) { /* Analyze till transition is impossible */",
     };
     static constexpr std::string_view text1[] = {
         "        uint8_t meta = symb2meta[(unsigned char)*first];",
@@ -65,16 +340,55 @@ void outputLexEngine(uxs::iobuf& outp, const EngineInfo& info) {
         "            state = def[state];",
         "        } while (state >= 0);",
     };
+    static constexpr std::string_view text1_interleaved[] = {
+        "        uint8_t meta = symb2meta[(unsigned char)*first];",
+        "        do {",
+        "            int l = state_info[state].base + meta;",
+        "            if (check_next[l].check == state) {",
+        "                state = check_next[l].next;",
+        "                break;",
+        "            }",
+        "            state = state_info[state].def;",
+        "        } while (state >= 0);",
+    };
     static constexpr std::string_view text1_compress0[] = {
         "        state = Dtran[256 * state + (unsigned char)*first];",
     };
     static constexpr std::string_view text1_compress1[] = {
         "        state = Dtran[dtran_width * state + symb2meta[(unsigned char)*first]];",
     };
-    static constexpr std::string_view text2[] = {
+    static constexpr std::string_view text2_loop[] = {
         "        if (state < 0) { goto unroll; }",
         "        *sptr++ = state, ++first;",
+    };
+    static constexpr std::string_view text2_loop_stackless[] = {
+        "        if (state < 0) { goto unroll; }",
+        "        ++first, ++llen;",
+    };
+    static constexpr std::string_view text3_loop_stackless[] = {
+        "        if (accept[state] > 0) { n_pat = accept[state], accept_len = llen; }",
+    };
+    static constexpr std::string_view text4_loop[] = {
+        "    }",
+    };
+    static constexpr std::string_view text2_stackless[] = {
+        "    if ((flags & flag_has_more) || !llen) {",
+        "        if (llen) { *sptr++ = n_pat, *sptr++ = (int)accept_len, *sptr++ = state; }",
+        "        *p_sptr = sptr;",
+        "        *p_llen = llen;",
+        "        return err_end_of_input;",
         "    }",
+        "unroll:",
+        "    *p_sptr = sptr;",
+        "    if (n_pat > 0) { /* Return last accepting state */",
+        "        *p_llen = accept_len;",
+        "        return n_pat;",
+        "    }",
+        "    *p_llen = 1; /* Accept at least one symbol as default pattern */",
+        "    return predef_pat_default;",
+        "}",
+    };
+    static constexpr std::string_view text2[] = {
         "    if ((flags & flag_has_more) || sptr == sptr0) {",
         "        *p_sptr = sptr;",
         "        *p_llen = (size_t)(sptr - sptr0);",
@@ -118,27 +432,132 @@ void outputLexEngine(uxs::iobuf& outp, const EngineInfo& info) {
         "    return predef_pat_default;",
         "}",
     };
+    auto output_text = [&outp](std::span<const std::string_view> text) {
+        for (const auto& l : text) { outp.write(l).put('\n'); }
+    };
+
+    // Note: the start condition is on the top of the stack only if the analysis is not resumed
+    std::string start_state("*(sptr - 1)");
+    if (info.has_left_nl_anchoring) {
+        start_state = "(*(sptr - 1) << 1) + ((flags & flag_at_beg_of_line) ? 1 : 0)";
+        if (!info.stackless) { start_state = "*p_llen ? *(sptr - 1) : " + start_state; }
+    }
+
     outp.put('\n');
-    for (const auto& l : text0) {
-        uxs::print(
-            outp, uxs::runtime_format{l}, info.state_type,
-            info.has_left_nl_anchoring ? "(*(sptr - 1) << 1) + ((flags & flag_at_beg_of_line) ? 1 : 0)" : "*(sptr - 1)")
-            .put('\n');
+    for (const auto& l : info.stackless ? std::span<const std::string_view>(text0_stackless) : text0) {
+        uxs::print(outp, uxs::runtime_format{l}, info.state_type, start_state).put('\n');
     }
-    if (info.compress_level == 0) {
-        for (const auto& l : text1_compress0) { outp.write(l).put('\n'); }
-    } else if (info.compress_level == 1) {
-        for (const auto& l : text1_compress1) { outp.write(l).put('\n'); }
+    if (info.direct_coded) {
+        outputDirectCode(outp, info, dfa_builder, run_skip);
     } else {
-        for (const auto& l : text1) { outp.write(l).put('\n'); }
+        output_text(text0_loop);
+        if (info.compress_level == 0) {
+            output_text(text1_compress0);
+        } else if (info.compress_level == 1) {
+            output_text(text1_compress1);
+        } else {
+            output_text(info.interleaved_tables ? std::span<const std::string_view>(text1_interleaved) : text1);
+        }
+        output_text(info.stackless ? std::span<const std::string_view>(text2_loop_stackless) : text2_loop);
+        if (!run_skip.sets.empty()) {
+            uxs::print(outp, "        if (skip_idx[state]) {{\n");
+            uxs::print(outp, "            switch (skip_idx[state]) {{\n");
+            for (unsigned set_idx = 1; set_idx <= run_skip.sets.size(); ++set_idx) {
+                uxs::print(outp, "                case {}: {{\n", set_idx);
+                outputRunSkip(outp, info, run_skip.sets[set_idx - 1], set_idx, "state", "                    ");
+                uxs::print(outp, "                }} break;\n");
+            }
+            uxs::print(outp, "            }}\n");
+            uxs::print(outp, "        }}\n");
+        }
+        if (info.stackless) { output_text(text3_loop_stackless); }
+        output_text(text4_loop);
     }
-    for (const auto& l : text2) { outp.write(l).put('\n'); }
-    if (info.has_trailing_context) {
-        for (const auto& l : text3_any_has_trail_context) { outp.write(l).put('\n'); }
-    } else {
-        for (const auto& l : text3) { outp.write(l).put('\n'); }
+    if (info.stackless) {
+        output_text(text2_stackless);
+        return;
+    }
+    output_text(text2);
+    output_text(info.has_trailing_context ? std::span<const std::string_view>(text3_any_has_trail_context) : text3);
+    output_text(text4);
+}
+
+// Tables are already output as `lex_traits` members, this adds the properties used by `lexegen::engine` template
+void outputLexTraits(uxs::iobuf& outp, const EngineInfo& info, const DfaBuilder& dfa_builder) {
+    outp.put('\n');
+    uxs::print(outp, "    using state_type = {};\n", info.stackless ? "int" : info.state_type);
+    uxs::print(outp, "    static constexpr int compress_level = {};\n", std::min(info.compress_level, 2));
+    if (info.compress_level == 1) {
+        uxs::print(outp, "    static constexpr int dtran_width = {};\n", dfa_builder.getMetaCount());
+    }
+    auto bool_str = [](bool b) { return b ? "true" : "false"; };
+    uxs::print(outp, "    static constexpr bool stackless = {};\n", bool_str(info.stackless));
+    uxs::print(outp, "    static constexpr bool has_trailing_context = {};\n", bool_str(info.has_trailing_context));
+    uxs::print(outp, "    static constexpr bool has_left_nl_anchoring = {};\n", bool_str(info.has_left_nl_anchoring));
+    uxs::print(outp, "}};\n");
+}
+
+void outputLexBatch(uxs::iobuf& outp, const EngineInfo& info) {
+    static constexpr std::string_view text0[] = {
+        "static size_t lex_batch(const char* base, const char** p_first, const char* last, {0}** p_sptr, {0}* slast,",
+        "                        size_t* p_llen, int flags, int* pats, size_t* offsets, size_t* lengths,",
+        "                        size_t max_count) {{",
+        "    const char* first = *p_first;",
+        "    {0}* sptr = *p_sptr;",
+        "    size_t llen = *p_llen, count = 0;",
+        "    while (count < max_count) {{ /* Analyze till the end of input, full state stack or `max_count` tokens */",
+        "        const char* lexeme_first = first - llen;",
+    };
+    static constexpr std::string_view text1[] = {
+        "        const char* trimmed_last = last;",
+        "        int pat;",
+        "        if (slast - sptr < last - first) { trimmed_last = first + (slast - sptr); }",
+        "        pat = lex(first, trimmed_last, &sptr, &llen, trimmed_last != last ? flags | flag_has_more : flags);",
+        "        if (pat < 0) {",
+        "            first = trimmed_last;",
+        "            break;",
+        "        }",
+    };
+    static constexpr std::string_view text1_stackless[] = {
+        "        int pat;",
+        "        if (slast - sptr < 3) { break; }",
+        "        pat = lex(first, last, &sptr, &llen, flags);",
+        "        if (pat < 0) {",
+        "            first = last;",
+        "            break;",
+        "        }",
+    };
+    static constexpr std::string_view text2[] = {
+        "        pats[count] = pat;",
+        "        offsets[count] = (size_t)(lexeme_first - base);",
+        "        lengths[count++] = llen;",
+        "        first = lexeme_first + llen;",
+        "        llen = 0;",
+    };
+    static constexpr std::string_view text2_left_nl_anchoring[] = {
+        "        flags = (flags & ~flag_at_beg_of_line) | (*(first - 1) == '\\n' ? flag_at_beg_of_line : 0);",
+    };
+    static constexpr std::string_view text3[] = {
+        "    }",
+        "    *p_first = first;",
+        "    *p_sptr = sptr;",
+        "    *p_llen = llen;",
+        "    return count;",
+        "}",
+    };
+
+    auto output_text = [&outp](std::span<const std::string_view> text) {
+        for (const auto& l : text) { outp.write(l).put('\n'); }
+    };
+
+    outp.put('\n');
+    for (const auto& l : text0) {
+        uxs::print(outp, uxs::runtime_format{l}, info.stackless ? "int" : info.state_type).put('\n');
     }
-    for (const auto& l : text4) { outp.write(l).put('\n'); }
+    output_text(info.stackless ? std::span<const std::string_view>(text1_stackless) : text1);
+    output_text(text2);
+    if (info.has_left_nl_anchoring) { output_text(text2_left_nl_anchoring); }
+    output_text(text3);
 }
 
 //---------------------------------------------------------------------------------------
@@ -146,12 +565,22 @@ void outputLexEngine(uxs::iobuf& outp, const EngineInfo& info) {
 int main(int argc, char** argv) {
     try {
         bool case_insensitive = false;
-        bool use_int8_if_possible = false;
+        bool use_int8_if_possible = false, use_int16_if_possible = false;
         bool show_help = false, show_version = false;
+        bool show_time_report = false;
+        bool stackless = false;
+        bool skip_runs = false;
+        bool emit_binary = false;
         int optimization_level = 1;
+        unsigned thread_count = 1;
         std::string input_file_name;
         std::string analyzer_file_name("lex_analyzer.inl");
         std::string defs_file_name("lex_defs.h");
+        std::string binary_file_name("lex_analyzer.bin");
+        std::string cache_dir;
+        std::string time_report_file_name;
+        std::string engine_type("table");
+        std::string table_layout("separate");
         EngineInfo eng_info;
         auto cli = uxs::cli::command(argv[0])
                    << uxs::cli::overview("A tool for regular-expression based lexical analyzer generation")
@@ -160,18 +589,50 @@ int main(int argc, char** argv) {
                           "Place the output analyzer into <file>."
                    << (uxs::cli::option({"--header-file="}) & uxs::cli::value("<file>", defs_file_name)) %
                           "Place the output definitions into <file>."
+                   << uxs::cli::option({"--emit-binary"}).set(emit_binary) %
+                          "Also write memory-mappable DFA image for `lexegen::dfa_image` runtime."
+                   << (uxs::cli::option({"--binary-file="}) & uxs::cli::value("<file>", binary_file_name)) %
+                          "Place the output DFA image into <file>."
                    << uxs::cli::option({"--no-case"}).set(case_insensitive) % "Build case insensitive analyzer."
                    << (uxs::cli::option({"--compress"}) & uxs::cli::value("<n>", eng_info.compress_level)) %
                           "Set compression level to <n>:\n"
                           "    0 - do not compress analyzer table, do not use `meta` table;\n"
                           "    1 - do not compress analyzer table;\n"
                           "    2 - Default compression."
+                   << (uxs::cli::option({"--engine="}) & uxs::cli::value("<type>", engine_type)) %
+                          "Set analyzer engine type to <type>:\n"
+                          "    table - Default engine interpreting transition tables;\n"
+                          "    direct - direct-coded engine with a labelled block per state, which switches\n"
+                          "             on the input character (`--compress 0`) or its meta-symbol;\n"
+                          "    template - `lex_traits` structure with `constexpr` tables for header-only\n"
+                          "               `lexegen::engine<Traits, Options>` C++ template."
+                   << (uxs::cli::option({"--table-layout="}) & uxs::cli::value("<layout>", table_layout)) %
+                          "Set layout of compressed tables (`--compress 2`) to <layout>:\n"
+                          "    separate - Default layout with a separate array per table;\n"
+                          "    interleaved - `check` and `next`, `base` and `def` are merged into records,\n"
+                          "                  tables are cache-line aligned."
+                   << uxs::cli::option({"--stackless"}).set(stackless) %
+                          "Track the last accepting state instead of pushing states (without trailing context)."
+                   << uxs::cli::option({"--skip-runs"}).set(skip_runs) %
+                          "Skip runs of symbols, on which a state loops to itself, in one step."
+                   << uxs::cli::option({"--batch-api"}).set(eng_info.batch_api) %
+                          "Also generate `lex_batch()` function, which tokenizes the input into token arrays."
                    << uxs::cli::option({"--use-int8-if-possible"}).set(use_int8_if_possible) %
                           "Use `int8_t` instead of `int` for states if state count is < 128."
+                   << uxs::cli::option({"--use-int16-if-possible"}).set(use_int16_if_possible) %
+                          "Use `int16_t` instead of `int` for states if state count is < 32768."
                    << (uxs::cli::option({"-O"}) & uxs::cli::value("<n>", optimization_level)) %
                           "Set optimization level to <n>:\n"
                           "    0 - Do not optimize analyzer states;\n"
                           "    1 - Default analyzer optimization."
+                   << (uxs::cli::option({"-j"}) & uxs::cli::value("<n>", thread_count)) %
+                          "Use <n> threads to build analyzer, 0 - use all available hardware threads."
+                   << (uxs::cli::option({"--cache-dir="}) & uxs::cli::value("<dir>", cache_dir)) %
+                          "Reuse output files cached in <dir> if the input file and the options are unchanged."
+                   << uxs::cli::option({"--time-report"}).set(show_time_report) %
+                          "Display time, memory usage and counters of generation phases."
+                   << (uxs::cli::option({"--time-report-json="}) & uxs::cli::value("<file>", time_report_file_name)) %
+                          "Write the time report to <file> in JSON format."
                    << uxs::cli::option({"-h", "--help"}).set(show_help) % "Display this information."
                    << uxs::cli::option({"-V", "--version"}).set(show_version) % "Display version.";
 
@@ -203,48 +664,107 @@ int main(int argc, char** argv) {
             return -1;
         }
 
+        if (engine_type == "direct") {
+            eng_info.direct_coded = true;
+        } else if (engine_type == "template") {
+            eng_info.template_traits = true;
+            if (skip_runs || eng_info.batch_api) {
+                logger::warning(input_file_name)
+                    .println("run skipping and batch API are not supported by template engine, so they are ignored");
+                skip_runs = eng_info.batch_api = false;
+            }
+        } else if (engine_type != "table") {
+            logger::fatal().println("unknown engine type `{}`", engine_type);
+            return -1;
+        }
+        if (table_layout == "interleaved") {
+            if (engine_type == "table" && eng_info.compress_level > 1) {
+                eng_info.interleaved_tables = true;
+            } else {
+                logger::warning(input_file_name)
+                    .println("interleaved table layout is used only by compressed table engine, so it is ignored");
+            }
+        } else if (table_layout != "separate") {
+            logger::fatal().println("unknown table layout `{}`", table_layout);
+            return -1;
+        }
+
+        std::vector<std::string> output_file_names{defs_file_name, analyzer_file_name};
+        if (emit_binary) { output_file_names.push_back(binary_file_name); }
+        std::optional<BuildCache> cache;
+        if (std::string input_text; !cache_dir.empty() && readFile(input_file_name, input_text)) {
+            // Note: only options affecting output files are included
+            std::string key = uxs::format(
+                "lexegen {}\n--no-case={} --compress={} --engine={} --table-layout={} --stackless={} --skip-runs={} "
+                "--batch-api={} --use-int8-if-possible={} --use-int16-if-possible={} --emit-binary={} -O={}\n",
+                XSTR(VERSION), case_insensitive, eng_info.compress_level, engine_type, table_layout, stackless,
+                skip_runs, eng_info.batch_api, use_int8_if_possible, use_int16_if_possible, emit_binary,
+                optimization_level);
+            cache.emplace(cache_dir, key + input_text);
+            if (cache->restore(output_file_names)) {
+                logger::info(input_file_name).println("restored from cache `{}`", cache->getEntryPath());
+                return 0;
+            }
+        }
+
         uxs::filebuf ifile(input_file_name.c_str(), "r");
         if (!ifile) {
             logger::fatal().println("could not open input file `{}`", input_file_name);
             return -1;
         }
 
+        TimeReport time_report;
+        TimeReport* p_time_report = show_time_report || !time_report_file_name.empty() ? &time_report : nullptr;
+        TimeReport::Phase phase(p_time_report, "parsing");
+
         Parser parser(ifile, input_file_name);
         if (!parser.parse()) { return -1; }
+        phase.finish();
 
         DfaBuilder dfa_builder(input_file_name);
+        dfa_builder.setTimeReport(p_time_report);
         const auto& start_conditions = parser.getStartConditions();
 
         unsigned n_pat = 0;
-        for (auto& pat : parser.getPatterns()) { dfa_builder.addPattern(std::move(pat.syn_tree), ++n_pat, pat.sc); }
+        for (auto& pat : parser.getPatterns()) { dfa_builder.addPattern(pat.syn_tree, ++n_pat, pat.sc); }
 
         // Build analyzer
         logger::info(input_file_name).println("\033[1;34mbuilding analyzer...\033[0m");
-        dfa_builder.build(static_cast<unsigned>(start_conditions.size()), case_insensitive);
+        if (thread_count == 0) { thread_count = std::max(std::thread::hardware_concurrency(), 1u); }
+        dfa_builder.build(static_cast<unsigned>(start_conditions.size()), case_insensitive, thread_count);
 
-        std::size_t state_sz = sizeof(int);
-        if (use_int8_if_possible && dfa_builder.getDtran().size() < 128) {
-            eng_info.state_type = "int8_t", state_sz = 1;
-        }
+        // Note: tables have the narrowest type for their values, the state stack type is chosen by options
+        auto select_state_type = [&dfa_builder, &eng_info, use_int8_if_possible, use_int16_if_possible]() {
+            const std::size_t state_count = dfa_builder.getDtran().size();
+            eng_info.state_type = "int";
+            if (use_int8_if_possible && state_count < 128) {
+                eng_info.state_type = "int8_t";
+            } else if (use_int16_if_possible && state_count < 32768) {
+                eng_info.state_type = "int16_t";
+            }
+        };
+        auto get_dtran_size = [&dfa_builder]() {
+            const std::size_t state_count = dfa_builder.getDtran().size();
+            return dfa_builder.getMetaCount() * state_count *
+                   getNarrowestType(-1, static_cast<int>(state_count) - 1).second;
+        };
 
-        logger::info(input_file_name)
-            .println(" - transition table size: {} bytes",
-                     dfa_builder.getMetaCount() * dfa_builder.getDtran().size() * state_sz);
+        select_state_type();
+        logger::info(input_file_name).println(" - transition table size: {} bytes", get_dtran_size());
         logger::info(input_file_name).println("\033[1;32mdone\033[0m");
 
         if (optimization_level > 0) {
             logger::info(input_file_name).println("\033[1;34moptimizing states...\033[0m");
+            phase.next("state optimization");
             dfa_builder.optimize();
-            if (use_int8_if_possible && dfa_builder.getDtran().size() < 128) {
-                eng_info.state_type = "int8_t", state_sz = 1;
-            }
-
-            logger::info(input_file_name)
-                .println(" - transition table size: {} bytes",
-                         dfa_builder.getMetaCount() * dfa_builder.getDtran().size() * state_sz);
+            phase.finish();
+            select_state_type();
+            logger::info(input_file_name).println(" - transition table size: {} bytes", get_dtran_size());
             logger::info(input_file_name).println("\033[1;32mdone\033[0m");
         }
 
+        phase.next("output");
+        bool output_written = true;
         if (uxs::filebuf ofile(defs_file_name.c_str(), "w"); ofile) {
             uxs::print(ofile, "/* Lexegen autogenerated definition file - do not edit! */\n");
             uxs::print(ofile, "/* clang-format off */\n");
@@ -273,6 +793,7 @@ int main(int argc, char** argv) {
             }
         } else {
             logger::error().println("could not open output file `{}`", defs_file_name);
+            output_written = false;
         }
 
         if (uxs::filebuf ofile(analyzer_file_name.c_str(), "w"); ofile) {
@@ -280,9 +801,31 @@ int main(int argc, char** argv) {
             uxs::print(ofile, "/* clang-format off */\n");
             const auto& symb2meta = dfa_builder.getSymb2Meta();
             const auto& Dtran = dfa_builder.getDtran();
+            // Interleaved tables are cache-line aligned, traits for the template engine keep tables as `constexpr`
+            // members
+            std::string_view table_specs = "static const";
+            std::size_t table_tab = 0;
+            if (eng_info.interleaved_tables) {
+                table_specs = "LEX_CACHE_ALIGNED static const";
+            } else if (eng_info.template_traits) {
+                table_specs = "static constexpr", table_tab = 4;
+                uxs::print(ofile, "\nstruct lex_traits {{");
+            }
+            std::vector<int> def, base, next, check;
+            if (eng_info.interleaved_tables) {
+                uxs::print(ofile, "\n#if !defined(LEX_CACHE_ALIGNED)\n");
+                uxs::print(ofile, "#    if defined(__cplusplus)\n");
+                uxs::print(ofile, "#        define LEX_CACHE_ALIGNED alignas(64)\n");
+                uxs::print(ofile, "#    else\n");
+                uxs::print(ofile, "#        define LEX_CACHE_ALIGNED _Alignas(64)\n");
+                uxs::print(ofile, "#    endif\n");
+                uxs::print(ofile, "#endif\n");
+            }
             if (eng_info.compress_level > 0) {
-                outputArray(ofile, "uint8_t", "symb2meta", symb2meta.begin(), symb2meta.end());
-                if (eng_info.compress_level == 1) {
+                outputArray(ofile, "uint8_t", "symb2meta", symb2meta.begin(), symb2meta.end(), table_specs, table_tab);
+                if (eng_info.direct_coded) {
+                    // Transitions are coded directly in `lex()`
+                } else if (eng_info.compress_level == 1) {
                     if (!Dtran.empty()) {
                         std::vector<int> dtran_data;
                         int dtran_width = dfa_builder.getMetaCount();
@@ -290,32 +833,45 @@ int main(int argc, char** argv) {
                         for (std::size_t j = 0; j < Dtran.size(); ++j) {
                             std::copy_n(Dtran[j].data(), dtran_width, std::back_inserter(dtran_data));
                         }
-                        uxs::print(ofile, "\nenum {{ dtran_width = {} }};\n", dtran_width);
-                        outputArray(ofile, eng_info.state_type, "Dtran", dtran_data.begin(), dtran_data.end());
+                        if (!eng_info.template_traits) {
+                            uxs::print(ofile, "\nenum {{ dtran_width = {} }};\n", dtran_width);
+                        }
+                        outputNarrowestArray(ofile, "Dtran", dtran_data.begin(), dtran_data.end(), table_specs,
+                                             table_tab);
                     }
                 } else {
-                    std::vector<int> def, base, next, check;
                     logger::info(input_file_name).println("\033[1;34mcompressing tables...\033[0m");
+                    phase.next("table compression");
                     dfa_builder.makeCompressedDtran(def, base, next, check);
+                    phase.next("output");
 
                     logger::info(input_file_name)
                         .println(" - total compressed transition table size: {} bytes",
-                                 (def.size() + next.size() + check.size()) * state_sz + base.size() * sizeof(int));
+                                 def.size() * getNarrowestType(def.begin(), def.end()).second +
+                                     base.size() * getNarrowestType(base.begin(), base.end()).second +
+                                     next.size() * getNarrowestType(next.begin(), next.end()).second +
+                                     check.size() * getNarrowestType(check.begin(), check.end()).second);
                     logger::info(input_file_name).println("\033[1;32mdone\033[0m");
 
-                    outputArray(ofile, eng_info.state_type, "def", def.begin(), def.end());
-                    outputArray(ofile, "int", "base", base.begin(), base.end());
-                    outputArray(ofile, eng_info.state_type, "next", next.begin(), next.end());
-                    outputArray(ofile, eng_info.state_type, "check", check.begin(), check.end());
+                    if (eng_info.interleaved_tables) {
+                        // `check` and `next` of one transition, `base` and `def` of one state share a cache line
+                        outputNarrowestRecordArray(ofile, "check_next", "check", check, "next", next, table_specs);
+                        outputNarrowestRecordArray(ofile, "state_info", "base", base, "def", def, table_specs);
+                    } else {
+                        outputNarrowestArray(ofile, "def", def.begin(), def.end(), table_specs, table_tab);
+                        outputNarrowestArray(ofile, "base", base.begin(), base.end(), table_specs, table_tab);
+                        outputNarrowestArray(ofile, "next", next.begin(), next.end(), table_specs, table_tab);
+                        outputNarrowestArray(ofile, "check", check.begin(), check.end(), table_specs, table_tab);
+                    }
                 }
-            } else if (!Dtran.empty()) {
+            } else if (!eng_info.direct_coded && !Dtran.empty()) {
                 std::vector<int> dtran_data;
                 dtran_data.reserve(256 * Dtran.size());
                 for (std::size_t j = 0; j < Dtran.size(); ++j) {
                     uxs::transform(symb2meta, std::back_inserter(dtran_data),
-                                   [&row = Dtran[j]](int meta) { return row[meta]; });
+                                   [row = Dtran[j]](int meta) { return row[meta]; });
                 }
-                outputArray(ofile, eng_info.state_type, "Dtran", dtran_data.begin(), dtran_data.end());
+                outputNarrowestArray(ofile, "Dtran", dtran_data.begin(), dtran_data.end(), table_specs, table_tab);
             }
 
             std::vector<int> accept = dfa_builder.getAccept();
@@ -337,7 +893,19 @@ int main(int argc, char** argv) {
                 }
             }
 
-            outputArray(ofile, "int", "accept", accept.begin(), accept.end());
+            if (stackless) {
+                if (!eng_info.has_trailing_context) {
+                    eng_info.stackless = true;
+                } else {
+                    logger::warning(input_file_name)
+                        .println("analyzer has patterns with trailing context, so the state stack is used");
+                }
+            }
+
+            if (!eng_info.direct_coded || !eng_info.stackless) {
+                // Direct-coded stackless engine has accepted patterns inlined
+                outputNarrowestArray(ofile, "accept", accept.begin(), accept.end(), table_specs, table_tab);
+            }
 
             if (eng_info.has_trailing_context) {
                 const auto& lls = dfa_builder.getLLS();
@@ -349,14 +917,61 @@ int main(int argc, char** argv) {
                     for (unsigned n_pat : pat_set) { lls_list.push_back(n_pat); }
                     lls_idx.push_back(static_cast<int>(lls_list.size()));
                 }
-                outputArray(ofile, "int", "lls_idx", lls_idx.begin(), lls_idx.end());
-                outputArray(ofile, "int", "lls_list", lls_list.begin(), lls_list.end());
+                outputNarrowestArray(ofile, "lls_idx", lls_idx.begin(), lls_idx.end(), table_specs, table_tab);
+                outputNarrowestArray(ofile, "lls_list", lls_list.begin(), lls_list.end(), table_specs, table_tab);
+            }
+
+            if (emit_binary) {
+                // The image has tables compressed as for `--compress 2`, they are made once if not made yet
+                if (def.empty()) { dfa_builder.makeCompressedDtran(def, base, next, check); }
+                if (!writeDfaImage(binary_file_name, dfa_builder, def, base, next, check, accept,
+                                   eng_info.has_trailing_context, eng_info.has_left_nl_anchoring)) {
+                    logger::error().println("could not write output file `{}`", binary_file_name);
+                    output_written = false;
+                }
+            }
+
+            RunSkipInfo run_skip;
+            if (skip_runs) {
+                run_skip = findSelfLoopSets(dfa_builder);
+                if (!run_skip.sets.empty()) {
+                    std::vector<int> skip_sets(32 * run_skip.sets.size());
+                    for (std::size_t n = 0; n < run_skip.sets.size(); ++n) {
+                        for (unsigned symb = 0; symb < 256; ++symb) {
+                            if (run_skip.sets[n][symb]) { skip_sets[32 * n + (symb >> 3)] |= 1 << (symb & 7); }
+                        }
+                    }
+                    outputArray(ofile, "uint8_t", "skip_sets", skip_sets.begin(), skip_sets.end());
+                    if (!eng_info.direct_coded) {
+                        outputNarrowestArray(ofile, "skip_idx", run_skip.skip_idx.begin(), run_skip.skip_idx.end());
+                    }
+                }
+                logger::info(input_file_name)
+                    .println(" - self-looping states: {}",
+                             std::count_if(run_skip.skip_idx.begin(), run_skip.skip_idx.end(),
+                                           [](unsigned idx) { return idx != 0; }));
+            }
+            if (eng_info.template_traits) {
+                outputLexTraits(ofile, eng_info, dfa_builder);
+            } else {
+                outputLexEngine(ofile, eng_info, dfa_builder, run_skip);
+                if (eng_info.batch_api) { outputLexBatch(ofile, eng_info); }
             }
-            outputLexEngine(ofile, eng_info);
         } else {
             logger::error().println("could not open output file `{}`", analyzer_file_name);
+            output_written = false;
         }
 
+        phase.finish();
+
+        if (cache && output_written && !cache->store(output_file_names)) {
+            logger::warning(input_file_name).println("could not store output files in cache `{}`", cache_dir);
+        }
+
+        if (show_time_report) { uxs::stdbuf::log().write(time_report.makeTable()); }
+        if (!time_report_file_name.empty() && !writeFile(time_report_file_name, time_report.makeJson())) {
+            logger::error().println("could not open output file `{}`", time_report_file_name);
+        }
         return 0;
     } catch (const std::exception& e) { logger::fatal().println("exception caught: {}", e.what()); }
     return -1;
@@ -1,87 +1,132 @@
 #include "node.h"
 
-#include <stdexcept>
+Node* NodePool::allocNode(NodeType type, const Node* left, const Node* right) {
+    if (chunks_.empty() || chunks_.back().size() == kChunkSize) { chunks_.emplace_back().reserve(kChunkSize); }
+    auto& node = chunks_.back().emplace_back(type);
+    node.left_ = left, node.right_ = right;
 
-std::unique_ptr<Node> Node::cloneTree() const {
-    auto new_node = clone();
-    if (left_) { new_node->left_ = left_->cloneTree(); }
-    if (right_) { new_node->right_ = right_->cloneTree(); }
-    return new_node;
-}
-
-//---------------------------------------------------------------------------------------
-
-void Node::calcFunctions(std::vector<PositionalNode*>& positions) {
-    assert(left_);
-    left_->calcFunctions(positions);
-    if (right_) { right_->calcFunctions(positions); }
-    switch (type_) {
+    // Node functions, which do not depend on position numbering, are calculated once
+    switch (type) {
+        case NodeType::kSymbol:
+        case NodeType::kSymbSet:
+        case NodeType::kTerm: {
+            node.position_count_ = 1;
+        } break;
+        case NodeType::kEmptySymb: {
+            node.nullable_ = true;
+        } break;
+        case NodeType::kTrailingContext: {
+            node.position_count_ = left->position_count_ + right->position_count_ + 1;
+        } break;
         case NodeType::kOr: {
-            assert(right_);
-            nullable_ = left_->nullable_ || right_->nullable_;
-            firstpos_ = left_->firstpos_ | right_->firstpos_;
-            lastpos_ = left_->lastpos_ | right_->lastpos_;
+            node.nullable_ = left->nullable_ || right->nullable_;
+            node.position_count_ = left->position_count_ + right->position_count_;
         } break;
         case NodeType::kCat: {
-            assert(right_);
-            nullable_ = left_->nullable_ && right_->nullable_;
-            firstpos_ = left_->firstpos_;
-            lastpos_ = right_->lastpos_;
-            if (left_->nullable_) { firstpos_ |= right_->firstpos_; }
-            if (right_->nullable_) { lastpos_ |= left_->lastpos_; }
+            node.nullable_ = left->nullable_ && right->nullable_;
+            node.position_count_ = left->position_count_ + right->position_count_;
         } break;
         case NodeType::kStar:
         case NodeType::kPlus:
         case NodeType::kQuestion:
         case NodeType::kLeftNlAnchoring:
         case NodeType::kLeftNotNlAnchoring: {
-            nullable_ = type_ == NodeType::kStar || type_ == NodeType::kQuestion || left_->nullable_;
-            firstpos_ = left_->firstpos_;
-            lastpos_ = left_->lastpos_;
+            node.nullable_ = type == NodeType::kStar || type == NodeType::kQuestion || left->nullable_;
+            node.position_count_ = left->position_count_;
         } break;
-        default: assert(false); break;
-    }
-
-    switch (type_) {
-        case NodeType::kCat: {
-            for (unsigned pos : left_->lastpos_) { positions[pos]->addFollowpos(right_->firstpos_); }
-        } break;
-        case NodeType::kStar:
-        case NodeType::kPlus: {
-            for (unsigned pos : left_->lastpos_) { positions[pos]->addFollowpos(left_->firstpos_); }
-        } break;
-        default: break;
     }
+    return &node;
 }
 
-void EmptySymbNode::calcFunctions(std::vector<PositionalNode*>& /*positions*/) { nullable_ = true; }
+const Node* NodePool::newNode(NodeType type, const Node* left, const Node* right) {
+    return allocNode(type, left, right);
+}
 
-void PositionalNode::calcFunctions(std::vector<PositionalNode*>& positions) {
-    position_ = static_cast<unsigned>(positions.size());
-    if (position_ > ValueSet::kMaxValue) { throw std::runtime_error("too many positions"); }
-    positions.push_back(this);
+const Node* NodePool::newSymbNode(unsigned symb) {
+    auto* node = allocNode(NodeType::kSymbol, nullptr, nullptr);
+    node->value_.symb = symb;
+    return node;
+}
 
-    nullable_ = false;
-    firstpos_.addValue(position_);
-    lastpos_.addValue(position_);
+const Node* NodePool::newSymbSetNode(const ValueSet& sset) {
+    auto* node = allocNode(NodeType::kSymbSet, nullptr, nullptr);
+    node->value_.sset = &symb_sets_.emplace_back(sset);
+    return node;
 }
 
-void TrailingContextNode::calcFunctions(std::vector<PositionalNode*>& positions) {
-    assert(left_);
-    assert(right_);
-    left_->calcFunctions(positions);
-    right_->calcFunctions(positions);
+const Node* NodePool::newTermNode(unsigned pat_no) {
+    auto* node = allocNode(NodeType::kTerm, nullptr, nullptr);
+    node->value_.pattern_no = pat_no;
+    return node;
+}
 
-    position_ = static_cast<unsigned>(positions.size());
-    if (position_ > ValueSet::kMaxValue) { throw std::runtime_error("too many positions"); }
-    positions.push_back(this);
+//---------------------------------------------------------------------------------------
 
-    nullable_ = false;
-    firstpos_ = left_->getFirstpos();
-    if (left_->isNullable()) { firstpos_.addValue(position_); }
-    lastpos_ = right_->getLastpos();
-    if (right_->isNullable()) { lastpos_.addValue(position_); }
+NodeFunctions calcFunctions(const Node* node, std::vector<const Node*>& positions, std::vector<ValueSet>& followpos) {
+    auto add_position = [node, &positions, &followpos]() {
+        positions.push_back(node);
+        followpos.emplace_back();
+        return static_cast<unsigned>(positions.size()) - 1;
+    };
 
-    for (unsigned pos : left_->getLastpos()) { positions[pos]->addFollowpos(position_); }
-    positions[position_]->addFollowpos(right_->getFirstpos());
+    NodeFunctions fn;
+    fn.nullable = node->isNullable();
+    switch (node->getType()) {
+        case NodeType::kSymbol:
+        case NodeType::kSymbSet:
+        case NodeType::kTerm: {
+            unsigned position = add_position();
+            fn.firstpos.addValue(position);
+            fn.lastpos.addValue(position);
+        } break;
+        case NodeType::kEmptySymb: break;
+        case NodeType::kTrailingContext: {
+            assert(node->getLeft());
+            assert(node->getRight());
+            auto left = calcFunctions(node->getLeft(), positions, followpos);
+            auto right = calcFunctions(node->getRight(), positions, followpos);
+            unsigned position = add_position();
+            fn.firstpos = std::move(left.firstpos);
+            if (left.nullable) { fn.firstpos.addValue(position); }
+            fn.lastpos = std::move(right.lastpos);
+            if (right.nullable) { fn.lastpos.addValue(position); }
+            for (unsigned pos : left.lastpos) { followpos[pos].addValue(position); }
+            followpos[position] |= right.firstpos;
+        } break;
+        case NodeType::kOr: {
+            assert(node->getLeft());
+            assert(node->getRight());
+            auto left = calcFunctions(node->getLeft(), positions, followpos);
+            auto right = calcFunctions(node->getRight(), positions, followpos);
+            fn.firstpos = std::move(left.firstpos);
+            fn.lastpos = std::move(left.lastpos);
+            fn.firstpos |= right.firstpos;
+            fn.lastpos |= right.lastpos;
+        } break;
+        case NodeType::kCat: {
+            assert(node->getLeft());
+            assert(node->getRight());
+            auto left = calcFunctions(node->getLeft(), positions, followpos);
+            auto right = calcFunctions(node->getRight(), positions, followpos);
+            for (unsigned pos : left.lastpos) { followpos[pos] |= right.firstpos; }
+            fn.firstpos = std::move(left.firstpos);
+            fn.lastpos = std::move(right.lastpos);
+            if (left.nullable) { fn.firstpos |= right.firstpos; }
+            if (right.nullable) { fn.lastpos |= left.lastpos; }
+        } break;
+        case NodeType::kStar:
+        case NodeType::kPlus:
+        case NodeType::kQuestion:
+        case NodeType::kLeftNlAnchoring:
+        case NodeType::kLeftNotNlAnchoring: {
+            assert(node->getLeft());
+            auto left = calcFunctions(node->getLeft(), positions, followpos);
+            if (node->getType() == NodeType::kStar || node->getType() == NodeType::kPlus) {
+                for (unsigned pos : left.lastpos) { followpos[pos] |= left.firstpos; }
+            }
+            fn.firstpos = std::move(left.firstpos);
+            fn.lastpos = std::move(left.lastpos);
+        } break;
+    }
+    return fn;
 }
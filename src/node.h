@@ -2,6 +2,7 @@
 
 #include "valset.h"
 
+#include <deque>
 #include <utility>
 #include <vector>
 
@@ -21,95 +22,73 @@ enum class NodeType {
     kTerm,                // Termination symbol
 };
 
-class PositionalNode;
-
-// Common node class
+// Syntax tree node: nodes are allocated by `NodePool` and refer to their children with plain pointers; nodes are
+// immutable, so a subtree can be shared by several parents, e.g. an expanded `{name}` definition
 class Node {
  public:
     explicit Node(NodeType type) : type_(type) {}
-    virtual ~Node() = default;
 
     NodeType getType() const { return type_; }
-    Node* getLeft() const { return left_.get(); }
-    void setLeft(std::unique_ptr<Node> left) { left_ = std::move(left); }
-    Node* getRight() const { return right_.get(); }
-    void setRight(std::unique_ptr<Node> right) { right_ = std::move(right); }
+    const Node* getLeft() const { return left_; }
+    const Node* getRight() const { return right_; }
     bool isNullable() const { return nullable_; }
-    const ValueSet& getFirstpos() const { return firstpos_; }
-    const ValueSet& getLastpos() const { return lastpos_; }
-    std::unique_ptr<Node> cloneTree() const;
-
-    virtual std::unique_ptr<Node> clone() const { return std::make_unique<Node>(type_); }
-    virtual void calcFunctions(std::vector<PositionalNode*>& positions);
+    unsigned getPositionCount() const { return position_count_; }
+    unsigned getSymbol() const {
+        assert(type_ == NodeType::kSymbol);
+        return value_.symb;
+    }
+    const ValueSet& getSymbSet() const {
+        assert(type_ == NodeType::kSymbSet);
+        return *value_.sset;
+    }
+    unsigned getPatternNo() const {
+        assert(type_ == NodeType::kTerm);
+        return value_.pattern_no;
+    }
+
+ private:
+    friend class NodePool;
 
- protected:
     NodeType type_;
-    std::unique_ptr<Node> left_, right_;  // Binary tree leaves
-    // Node functions:
-    bool nullable_ = false;  // nullable(node) function
-    ValueSet firstpos_;      // firstpos(node) function
-    ValueSet lastpos_;       // lastpos(node) function
+    union {
+        unsigned symb;         // Node symbol
+        const ValueSet* sset;  // Node symbol set, is kept by the pool
+        unsigned pattern_no;   // Termination node pattern number
+    } value_{0};
+    const Node* left_ = nullptr;  // Binary tree leaves
+    const Node* right_ = nullptr;
+    bool nullable_ = false;        // nullable(node) function
+    unsigned position_count_ = 0;  // Position count in the subtree, counting all uses of shared subtrees
 };
 
-// Empty symbol node class
-class EmptySymbNode : public Node {
+// Node pool: allocates nodes in chunks and frees them all at once
+class NodePool {
  public:
-    EmptySymbNode() : Node(NodeType::kEmptySymb) {}
-    std::unique_ptr<Node> clone() const override { return std::make_unique<EmptySymbNode>(); }
-    void calcFunctions(std::vector<PositionalNode*>& positions) override;
-};
-
-// Positional node class
-class PositionalNode : public Node {
- public:
-    explicit PositionalNode(NodeType type) : Node(type) {}
-    void calcFunctions(std::vector<PositionalNode*>& positions) override;
-    const ValueSet& getFollowpos() const { return followpos_; }
-    void addFollowpos(unsigned pos) { followpos_.addValue(pos); }
-    void addFollowpos(const ValueSet& pos_set) { followpos_ |= pos_set; }
-
- protected:
-    unsigned position_ = 0;  // Node position
-    ValueSet followpos_;     // followpos(node) function
-};
+    static const std::size_t kChunkSize = 1024;
 
-// Symbol node class
-class SymbNode : public PositionalNode {
- public:
-    explicit SymbNode(unsigned symb) : PositionalNode(NodeType::kSymbol), symb_(symb) {}
-    unsigned getSymbol() const { return symb_; }
-    std::unique_ptr<Node> clone() const override { return std::make_unique<SymbNode>(symb_); }
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
 
- protected:
-    unsigned symb_;  // Node symbol
-};
+    const Node* newNode(NodeType type, const Node* left = nullptr, const Node* right = nullptr);
+    const Node* newSymbNode(unsigned symb);
+    const Node* newSymbSetNode(const ValueSet& sset);
+    const Node* newTermNode(unsigned pat_no);
 
-// Symbol set node class
-class SymbSetNode : public PositionalNode {
- public:
-    explicit SymbSetNode(const ValueSet& sset) : PositionalNode(NodeType::kSymbSet), sset_(sset) {}
-    const ValueSet& getSymbSet() const { return sset_; }
-    std::unique_ptr<Node> clone() const override { return std::make_unique<SymbSetNode>(sset_); }
+ private:
+    Node* allocNode(NodeType type, const Node* left, const Node* right);
 
- protected:
-    ValueSet sset_;
+    std::vector<std::vector<Node>> chunks_;
+    std::deque<ValueSet> symb_sets_;
 };
 
-// Trailing context node
-class TrailingContextNode : public PositionalNode {
- public:
-    TrailingContextNode() : PositionalNode(NodeType::kTrailingContext) {}
-    std::unique_ptr<Node> clone() const override { return std::make_unique<TrailingContextNode>(); }
-    void calcFunctions(std::vector<PositionalNode*>& positions) override;
+// Node functions
+struct NodeFunctions {
+    bool nullable = false;  // nullable(node) function
+    ValueSet firstpos;      // firstpos(node) function
+    ValueSet lastpos;       // lastpos(node) function
 };
 
-// Termination node class
-class TermNode : public PositionalNode {
- public:
-    explicit TermNode(unsigned pat_no) : PositionalNode(NodeType::kTerm), pattern_no_(pat_no) {}
-    unsigned getPatternNo() const { return pattern_no_; }
-    std::unique_ptr<Node> clone() const override { return std::make_unique<TermNode>(pattern_no_); }
-
- protected:
-    unsigned pattern_no_;
-};
+// Scatters positions of the tree to `positions` and calculates node functions; followpos(pos) function is
+// accumulated in `followpos[pos]`; a shared subtree gets new positions for each its use
+NodeFunctions calcFunctions(const Node* node, std::vector<const Node*>& positions, std::vector<ValueSet>& followpos);
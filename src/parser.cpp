@@ -1,5 +1,7 @@
 #include "parser.h"
 
+#include "utf8.h"
+
 #include <uxs/algorithm.h>
 
 #include <optional>
@@ -63,12 +65,12 @@ bool Parser::parse() {
                 }
 
                 state_stack_.push_back(lex_detail::sc_regex);
-                std::unique_ptr<Node> syn_tree;
+                const Node* syn_tree = nullptr;
                 std::tie(syn_tree, tt) = parseRegex(lex());
                 state_stack_.pop_back();
 
                 if (!syn_tree) { return false; }
-                definitions_.emplace(name, std::move(syn_tree));
+                definitions_.emplace(name, syn_tree);
             } break;
             case parser_detail::tt_option: {  // Option
                 if ((tt = lex()) != parser_detail::tt_id) {
@@ -91,7 +93,7 @@ bool Parser::parse() {
     do {
         if ((tt = lex()) == parser_detail::tt_id) {
             std::string_view name = std::get<std::string_view>(tkn_.val);
-            if (uxs::contains_if(patterns_, [&](const auto& pat) { return pat.id == name; })) {
+            if (!pattern_ids_.emplace(name).second) {
                 logger::error(*this, tkn_.loc).println("pattern is already defined");
                 return false;
             }
@@ -126,12 +128,12 @@ bool Parser::parse() {
                 state_stack_.pop_back();
             }
 
-            std::unique_ptr<Node> syn_tree;
+            const Node* syn_tree = nullptr;
             std::tie(syn_tree, tt) = parseRegex(tt);
             state_stack_.pop_back();
 
             if (!syn_tree) { return false; }
-            patterns_.emplace_back(name, sc, std::move(syn_tree));
+            patterns_.emplace_back(name, sc, syn_tree);
         } else if (tt != parser_detail::tt_sep) {
             logSyntaxError(tt);
             return false;
@@ -146,54 +148,39 @@ bool Parser::parse() {
 }
 
 namespace {
-std::unique_ptr<Node> makeMultiplicateNode(std::unique_ptr<Node> node, std::span<const unsigned> num) {
-    const auto* child = node.get();
+// Note: repeated `node` subtree is shared, not copied
+const Node* makeMultiplicateNode(NodePool& pool, const Node* node, std::span<const unsigned> num) {
     // Mandatory part
-    std::unique_ptr<Node> left_subtree;
+    const Node* left_subtree = nullptr;
     if (num[0] > 0) {
-        left_subtree = std::move(node);
-        for (unsigned i = 1; i < num[0]; ++i) {
-            auto cat_node = std::make_unique<Node>(NodeType::kCat);
-            cat_node->setLeft(std::move(left_subtree));
-            cat_node->setRight(child->clone());
-            left_subtree = std::move(cat_node);
-        }
+        left_subtree = node;
+        for (unsigned i = 1; i < num[0]; ++i) { left_subtree = pool.newNode(NodeType::kCat, left_subtree, node); }
     }
     // Optional part
-    std::unique_ptr<Node> right_subtree;
+    const Node* right_subtree = nullptr;
     if (num.size() < 2) {  // Infinite multiplication
-        right_subtree = std::make_unique<Node>(NodeType::kStar);
-        right_subtree->setLeft(num[0] > 0 ? child->clone() : std::move(node));
-        assert(right_subtree->getLeft());
+        right_subtree = pool.newNode(NodeType::kStar, node);
     } else if (num[1] > num[0]) {  // Finite multiplication
-        right_subtree = std::make_unique<Node>(NodeType::kQuestion);
-        right_subtree->setLeft(num[0] > 0 ? child->clone() : std::move(node));
+        right_subtree = pool.newNode(NodeType::kQuestion, node);
         for (unsigned i = num[0] + 1; i < num[1]; i++) {
-            auto cat_node = std::make_unique<Node>(NodeType::kCat);
-            cat_node->setLeft(std::move(right_subtree));
-            cat_node->setRight(std::make_unique<Node>(NodeType::kQuestion));
-            cat_node->getRight()->setLeft(child->clone());
-            right_subtree = std::move(cat_node);
+            right_subtree = pool.newNode(NodeType::kCat, right_subtree, pool.newNode(NodeType::kQuestion, node));
         }
     }
     // Concatenate mandatory and optional parts
     if (left_subtree && right_subtree) {
-        auto cat_node = std::make_unique<Node>(NodeType::kCat);
-        cat_node->setLeft(std::move(left_subtree));
-        cat_node->setRight(std::move(right_subtree));
-        return cat_node;
+        return pool.newNode(NodeType::kCat, left_subtree, right_subtree);
     } else if (left_subtree) {
         return left_subtree;
     } else if (right_subtree) {
         return right_subtree;
     }
-    return std::make_unique<EmptySymbNode>();
+    return pool.newNode(NodeType::kEmptySymb);
 }
 }  // namespace
 
-std::pair<std::unique_ptr<Node>, int> Parser::parseRegex(int tt) {
+std::pair<const Node*, int> Parser::parseRegex(int tt) {
     unsigned num[2] = {0, 0}, num_given = 0;
-    std::vector<std::unique_ptr<Node>> node_stack;
+    std::vector<const Node*> node_stack;
     uxs::inline_basic_dynbuffer<int, 1> sstack;
 
     node_stack.reserve(256);
@@ -211,102 +198,90 @@ std::pair<std::unique_ptr<Node>, int> Parser::parseRegex(int tt) {
         } else if (act != parser_detail::predef_act_shift) {
             switch (act) {
                 case parser_detail::act_trailing_context: {  // Trailing context
-                    auto trail_cont_node = std::make_unique<TrailingContextNode>();
-                    trail_cont_node->setRight(std::move(node_stack.back()));
+                    auto* right = node_stack.back();
                     node_stack.pop_back();
-                    trail_cont_node->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(trail_cont_node);
+                    node_stack.back() = node_pool_.newNode(NodeType::kTrailingContext, node_stack.back(), right);
                 } break;
                 case parser_detail::act_or: {  // Or
-                    auto or_node = std::make_unique<Node>(NodeType::kOr);
-                    or_node->setRight(std::move(node_stack.back()));
+                    auto* right = node_stack.back();
                     node_stack.pop_back();
-                    or_node->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(or_node);
+                    node_stack.back() = node_pool_.newNode(NodeType::kOr, node_stack.back(), right);
                 } break;
                 case parser_detail::act_left_nl_anchoring: {  // Left newline anchoring
-                    auto left_nl_anchoring = std::make_unique<Node>(NodeType::kLeftNlAnchoring);
-                    left_nl_anchoring->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(left_nl_anchoring);
+                    node_stack.back() = node_pool_.newNode(NodeType::kLeftNlAnchoring, node_stack.back());
                 } break;
                 case parser_detail::act_left_not_nl_anchoring: {  // Left newline anchoring
-                    auto left_not_nl_anchoring = std::make_unique<Node>(NodeType::kLeftNotNlAnchoring);
-                    left_not_nl_anchoring->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(left_not_nl_anchoring);
+                    node_stack.back() = node_pool_.newNode(NodeType::kLeftNotNlAnchoring, node_stack.back());
                 } break;
                 case parser_detail::act_right_nl_anchoring: {  // Right newline anchoring: '/\n' equivalent
-                    auto right_nl_anchoring = std::make_unique<TrailingContextNode>();
-                    right_nl_anchoring->setLeft(std::move(node_stack.back()));
-                    right_nl_anchoring->setRight(std::make_unique<SymbNode>('\n'));
-                    node_stack.back() = std::move(right_nl_anchoring);
+                    node_stack.back() = node_pool_.newNode(NodeType::kTrailingContext, node_stack.back(),
+                                                           node_pool_.newSymbNode('\n'));
                 } break;
                 case parser_detail::act_cat: {  // Cat
-                    auto cat_node = std::make_unique<Node>(NodeType::kCat);
-                    cat_node->setRight(std::move(node_stack.back()));
+                    auto* right = node_stack.back();
                     node_stack.pop_back();
-                    cat_node->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(cat_node);
+                    node_stack.back() = node_pool_.newNode(NodeType::kCat, node_stack.back(), right);
                 } break;
                 case parser_detail::act_star: {  // Star
-                    auto star_node = std::make_unique<Node>(NodeType::kStar);
-                    star_node->setLeft(std::move(node_stack.back()));
-                    assert(star_node->getLeft());
-                    node_stack.back() = std::move(star_node);
+                    assert(node_stack.back());
+                    node_stack.back() = node_pool_.newNode(NodeType::kStar, node_stack.back());
                 } break;
                 case parser_detail::act_plus: {  // Plus
-                    auto plus_node = std::make_unique<Node>(NodeType::kPlus);
-                    plus_node->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(plus_node);
+                    node_stack.back() = node_pool_.newNode(NodeType::kPlus, node_stack.back());
                 } break;
                 case parser_detail::act_question: {  // Question
-                    auto question_node = std::make_unique<Node>(NodeType::kQuestion);
-                    question_node->setLeft(std::move(node_stack.back()));
-                    node_stack.back() = std::move(question_node);
+                    node_stack.back() = node_pool_.newNode(NodeType::kQuestion, node_stack.back());
                 } break;
                 case parser_detail::act_mult_exact: {  // Multiplicate node (exact count)
                     num[1] = num[0];
-                    node_stack.back() = makeMultiplicateNode(std::move(node_stack.back()), est::as_span(num, 2));
+                    node_stack.back() = makeMultiplicateNode(node_pool_, node_stack.back(), est::as_span(num, 2));
+                    num_given = 0;
                 } break;
                 case parser_detail::act_mult_not_more_than: {  // Multiplicate node (not more than given count)
                     num[1] = num[0], num[0] = 0;
-                    node_stack.back() = makeMultiplicateNode(std::move(node_stack.back()), est::as_span(num, 2));
+                    node_stack.back() = makeMultiplicateNode(node_pool_, node_stack.back(), est::as_span(num, 2));
+                    num_given = 0;
                 } break;
                 case parser_detail::act_mult_not_less_than: {  // Multiplicate node (not less than given count)
-                    node_stack.back() = makeMultiplicateNode(std::move(node_stack.back()), est::as_span(num, 1));
+                    node_stack.back() = makeMultiplicateNode(node_pool_, node_stack.back(), est::as_span(num, 1));
+                    num_given = 0;
                 } break;
                 case parser_detail::act_mult_range: {  // Multiplicate node (given range)
-                    node_stack.back() = makeMultiplicateNode(std::move(node_stack.back()), est::as_span(num, 2));
+                    node_stack.back() = makeMultiplicateNode(node_pool_, node_stack.back(), est::as_span(num, 2));
+                    num_given = 0;
                 } break;
             }
         } else if (tt != parser_detail::tt_nl) {
             switch (tt) {
                 case parser_detail::tt_symb: {  // Create `symbol` subtree
-                    node_stack.emplace_back(std::make_unique<SymbNode>(std::get<unsigned>(tkn_.val)));
+                    node_stack.push_back(node_pool_.newSymbNode(std::get<unsigned>(tkn_.val)));
                 } break;
                 case parser_detail::tt_sset: {  // Create `symbol set` subtree
-                    node_stack.emplace_back(std::make_unique<SymbSetNode>(std::get<ValueSet>(tkn_.val)));
+                    if (const auto* utf8_node = std::get_if<const Node*>(&tkn_.val)) {
+                        node_stack.push_back(*utf8_node);
+                    } else {
+                        node_stack.push_back(node_pool_.newSymbSetNode(std::get<ValueSet>(tkn_.val)));
+                    }
                 } break;
-                case parser_detail::tt_id: {  // Insert subtree
+                case parser_detail::tt_id: {  // Insert shared definition subtree
                     auto [pat_it, found] = uxs::find(definitions_, std::get<std::string_view>(tkn_.val));
                     if (!found) {
                         logger::error(*this, tkn_.loc).println("undefined regular expression");
                         return {nullptr, tt};
                     }
-                    node_stack.emplace_back(pat_it->second->cloneTree());
+                    node_stack.push_back(pat_it->second);
                 } break;
                 case parser_detail::tt_string: {  // Create `string` subtree
                     const auto& str = std::get<std::string_view>(tkn_.val);
                     if (!str.empty()) {
-                        std::unique_ptr<Node> str_node = std::make_unique<SymbNode>(static_cast<unsigned char>(str[0]));
+                        auto* str_node = node_pool_.newSymbNode(static_cast<unsigned char>(str[0]));
                         for (std::size_t i = 1; i < str.size(); ++i) {
-                            auto cat_node = std::make_unique<Node>(NodeType::kCat);
-                            cat_node->setLeft(std::move(str_node));
-                            cat_node->setRight(std::make_unique<SymbNode>(static_cast<unsigned char>(str[i])));
-                            str_node = std::move(cat_node);
+                            str_node = node_pool_.newNode(NodeType::kCat, str_node,
+                                                          node_pool_.newSymbNode(static_cast<unsigned char>(str[i])));
                         }
-                        node_stack.emplace_back(std::move(str_node));
+                        node_stack.push_back(str_node);
                     } else {
-                        node_stack.emplace_back(std::make_unique<EmptySymbNode>());
+                        node_stack.push_back(node_pool_.newNode(NodeType::kEmptySymb));
                     }
                 } break;
                 case parser_detail::tt_num: {  // Save number
@@ -320,12 +295,13 @@ std::pair<std::unique_ptr<Node>, int> Parser::parseRegex(int tt) {
         }
     }
     assert(node_stack.size() == 1);
-    return {std::move(node_stack.back()), tt};
+    return {node_stack.back(), tt};
 }
 
 int Parser::lex() {
-    bool sset_is_inverted = false, sset_range_flag = false;
+    bool sset_is_inverted = false, sset_range_flag = false, sset_last_is_code_point = false;
     unsigned sset_last = 0;
+    ValueSet sset_code_points;  // Non-ASCII code points of the symbol set
     char* str_start = nullptr;
     char* str_end = nullptr;
     tkn_.loc = {ln_, col_, col_};
@@ -335,6 +311,33 @@ int Parser::lex() {
         logger::error(*this, tkn_.loc).println("zero escape character is not allowed");
     };
 
+    // Adds a byte or a code point to the symbol set; a range is of code points if one of its bounds is a code point,
+    // then the other bound must not be a non-ASCII byte
+    auto add_symb_set_item = [&](unsigned v, bool is_code_point) {
+        auto& valset = std::get<ValueSet>(tkn_.val);
+        unsigned from = v;
+        if (sset_range_flag) {
+            from = sset_last, sset_range_flag = false;
+            if (from > v) {
+                logger::error(*this, tkn_.loc).println("invalid symbol range");
+                return false;
+            } else if ((is_code_point && !sset_last_is_code_point && from >= 0x80) ||
+                       (!is_code_point && sset_last_is_code_point && v >= 0x80)) {
+                logger::error(*this, tkn_.loc).println("symbol range bounds are a non-ASCII byte and a code point");
+                return false;
+            }
+            is_code_point = is_code_point || sset_last_is_code_point;
+        }
+        sset_last = v, sset_last_is_code_point = is_code_point;
+        if (!is_code_point || v < 0x80) {
+            valset.addValues(from, v);
+            return true;
+        }
+        if (from < 0x80) { valset.addValues(from, 0x7f), from = 0x80; }
+        sset_code_points.addValues(from, v).removeValues(kSurrogateFirst, kSurrogateLast);
+        return true;
+    };
+
     while (true) {
         const char* first = first_;
         const char* lexeme = first;
@@ -367,6 +370,7 @@ int Parser::lex() {
         tkn_.loc.col_last = col_ - 1;
 
         std::optional<char> escape;
+        std::optional<unsigned> code_point;
         switch (pat) {
             // ------ escape sequences
             case lex_detail::pat_escape_a: escape = '\a'; break;
@@ -394,6 +398,22 @@ int Parser::lex() {
                     return parser_detail::tt_lexical_error;
                 }
             } break;
+            case lex_detail::pat_escape_unicode: {  // \u{X}
+                unsigned code = 0;
+                for (unsigned n = 3; n < llen - 1; ++n) { code = (code << 4) + uxs::dig_v(lexeme[n]); }
+                if (!code) {
+                    print_zero_escape_char_msg();
+                    return parser_detail::tt_lexical_error;
+                } else if (code > kMaxCodePoint || (code >= kSurrogateFirst && code <= kSurrogateLast)) {
+                    logger::error(*this, tkn_.loc).println("invalid code point");
+                    return parser_detail::tt_lexical_error;
+                }
+                if (code < 0x80) {
+                    escape = static_cast<char>(code);
+                } else {
+                    code_point = code;
+                }
+            } break;
 
             // ------ strings
             case lex_detail::pat_string: {
@@ -414,19 +434,18 @@ int Parser::lex() {
             case lex_detail::pat_regex_symb_set:
             case lex_detail::pat_regex_symb_set_inv: {
                 sset_is_inverted = pat == lex_detail::pat_regex_symb_set_inv;
-                sset_range_flag = false;
+                sset_range_flag = false, sset_last_is_code_point = false;
                 sset_last = 0;
+                sset_code_points.clear();
                 tkn_.val.emplace<ValueSet>();
                 state_stack_.push_back(lex_detail::sc_symb_set);
             } break;
             case lex_detail::pat_symb_set_seq: {
-                auto& valset = std::get<ValueSet>(tkn_.val);
-                if (sset_range_flag) {
-                    valset.addValues(sset_last, static_cast<unsigned char>(*lexeme));
-                    sset_range_flag = false;
+                for (unsigned n = 0; n < llen; ++n) {
+                    if (!add_symb_set_item(static_cast<unsigned char>(lexeme[n]), false)) {
+                        return parser_detail::tt_lexical_error;
+                    }
                 }
-                sset_last = static_cast<unsigned char>(lexeme[llen - 1]);
-                for (unsigned n = 0; n < llen; ++n) { valset.addValue(static_cast<unsigned char>(lexeme[n])); }
             } break;
             case lex_detail::pat_symb_set_range: {
                 if (!sset_range_flag && sset_last != '\0') {
@@ -477,8 +496,26 @@ int Parser::lex() {
             case lex_detail::pat_symb_set_close: {
                 auto& valset = std::get<ValueSet>(tkn_.val);
                 if (sset_range_flag) { valset.addValue('-'); }  // Treat `-` as a character
-                if (sset_is_inverted) { valset ^= ValueSet(1, 255); }
                 state_stack_.pop_back();
+                if (sset_code_points.empty()) {
+                    if (sset_is_inverted) { valset ^= ValueSet(1, 255); }
+                    return parser_detail::tt_sset;
+                }
+                // Set with code points is inverted in code point space and matches UTF-8 encoded sequences
+                if (sset_is_inverted) {
+                    if (!(valset & ValueSet(0x80, 0xff)).empty()) {
+                        logger::error(*this, tkn_.loc).println("inverted set of non-ASCII bytes and code points");
+                        return parser_detail::tt_lexical_error;
+                    }
+                    valset ^= ValueSet(1, 0x7f);
+                    sset_code_points ^= ValueSet(0x80, kMaxCodePoint);
+                    sset_code_points.removeValues(kSurrogateFirst, kSurrogateLast);
+                }
+                const Node* utf8_node = makeUtf8Node(node_pool_, sset_code_points);
+                if (!valset.empty()) {
+                    utf8_node = node_pool_.newNode(NodeType::kOr, node_pool_.newSymbSetNode(valset), utf8_node);
+                }
+                tkn_.val = utf8_node;
                 return parser_detail::tt_sset;
             } break;
             case lex_detail::pat_regex_dot: {
@@ -542,14 +579,9 @@ int Parser::lex() {
             switch (state_stack_.back()) {
                 case lex_detail::sc_string: *str_end++ = *escape; break;
                 case lex_detail::sc_symb_set: {
-                    auto& valset = std::get<ValueSet>(tkn_.val);
-                    if (sset_range_flag) {
-                        valset.addValues(sset_last, static_cast<unsigned char>(*escape));
-                        sset_range_flag = false;
-                    } else {
-                        valset.addValue(static_cast<unsigned char>(*escape));
+                    if (!add_symb_set_item(static_cast<unsigned char>(*escape), false)) {
+                        return parser_detail::tt_lexical_error;
                     }
-                    sset_last = static_cast<unsigned char>(*escape);
                 } break;
                 case lex_detail::sc_regex:
                 case lex_detail::sc_sc_list: {
@@ -557,6 +589,19 @@ int Parser::lex() {
                     return parser_detail::tt_symb;
                 } break;
             }
+        } else if (code_point) {  // Process code point: the encoding is not longer than the escape sequence
+            switch (state_stack_.back()) {
+                case lex_detail::sc_string: str_end += encodeUtf8(*code_point, str_end); break;
+                case lex_detail::sc_symb_set: {
+                    if (!add_symb_set_item(*code_point, true)) { return parser_detail::tt_lexical_error; }
+                } break;
+                case lex_detail::sc_regex:
+                case lex_detail::sc_sc_list: {  // Encoded sequence is placed instead of the escape sequence
+                    char* seq = first_ - llen;
+                    tkn_.val = std::string_view(seq, encodeUtf8(*code_point, seq));
+                    return parser_detail::tt_string;
+                } break;
+            }
         }
     }
     return parser_detail::tt_eof;
@@ -5,6 +5,7 @@
 
 #include <list>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 
 namespace lex_detail {
@@ -18,11 +19,11 @@ namespace parser_detail {
 class Parser {
  public:
     struct Pattern {
-        Pattern(std::string_view in_id, const ValueSet& in_sc, std::unique_ptr<Node> in_syn_tree)
-            : id(in_id), sc(in_sc), syn_tree(std::move(in_syn_tree)) {}
+        Pattern(std::string_view in_id, const ValueSet& in_sc, const Node* in_syn_tree)
+            : id(in_id), sc(in_sc), syn_tree(in_syn_tree) {}
         std::string_view id;
         ValueSet sc;
-        std::unique_ptr<Node> syn_tree;
+        const Node* syn_tree;
     };
 
     Parser(uxs::iobuf& input, std::string file_name);
@@ -33,7 +34,8 @@ class Parser {
     uxs::iterator_range<std::list<Pattern>::iterator> getPatterns() { return uxs::make_range(patterns_); }
 
  private:
-    using TokenVal = std::variant<unsigned, std::string_view, ValueSet>;
+    // Note: symbol set with code points is passed as UTF-8 byte sequence subtree
+    using TokenVal = std::variant<unsigned, std::string_view, ValueSet, const Node*>;
 
     struct TokenInfo {
         TokenVal val;
@@ -50,11 +52,13 @@ class Parser {
     uxs::inline_basic_dynbuffer<int, 1> state_stack_;
     TokenInfo tkn_;
     std::unordered_map<std::string_view, std::string_view> options_;
-    std::unordered_map<std::string_view, std::unique_ptr<Node>> definitions_;
+    NodePool node_pool_;
+    std::unordered_map<std::string_view, const Node*> definitions_;
     std::vector<std::string_view> start_conditions_;
     std::list<Pattern> patterns_;
+    std::unordered_set<std::string_view> pattern_ids_;
 
-    std::pair<std::unique_ptr<Node>, int> parseRegex(int tt);
+    std::pair<const Node*, int> parseRegex(int tt);
 
     int lex();
     void logSyntaxError(int tt) const;
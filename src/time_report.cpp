@@ -0,0 +1,104 @@
+#include "time_report.h"
+
+#include <uxs/format.h>
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#    include <windows.h>
+//
+#    include <psapi.h>
+#else
+#    include <sys/resource.h>
+#endif
+
+namespace {
+double getCpuTime() {  // Process CPU time in seconds
+#if defined(_WIN32)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) { return 0; }
+    auto to_seconds = [](const FILETIME& t) {
+        return 1e-7 * static_cast<double>((static_cast<std::uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime);
+    };
+    return to_seconds(kernel_time) + to_seconds(user_time);
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+    auto to_seconds = [](const timeval& t) { return static_cast<double>(t.tv_sec) + 1e-6 * t.tv_usec; };
+    return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+#endif
+}
+
+std::size_t getPeakRss() {  // Process peak resident set size in bytes
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#    if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#    else
+    return 1024 * static_cast<std::size_t>(usage.ru_maxrss);
+#    endif
+#endif
+}
+}  // namespace
+
+void TimeReport::Phase::start(std::string_view name) {
+    if (!report_) { return; }
+    running_ = true;
+    name_ = name;
+    wall_start_ = std::chrono::steady_clock::now();
+    cpu_start_ = getCpuTime();
+}
+
+void TimeReport::Phase::finish() {
+    if (!running_) { return; }
+    running_ = false;
+    auto it = std::find_if(report_->phases_.begin(), report_->phases_.end(),
+                           [this](const auto& phase) { return phase.name == name_; });
+    auto& phase = it != report_->phases_.end() ? *it : report_->phases_.emplace_back();
+    phase.name = name_;
+    phase.wall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_).count();
+    phase.cpu_time += getCpuTime() - cpu_start_;
+    phase.peak_rss = getPeakRss();
+}
+
+void TimeReport::addCounter(std::string_view name, std::uint64_t value) {
+    for (auto& [counter_name, counter_value] : counters_) {
+        if (counter_name == name) {
+            counter_value += value;
+            return;
+        }
+    }
+    counters_.emplace_back(name, value);
+}
+
+std::string TimeReport::makeTable() const {
+    std::string table = uxs::format("{:<32}{:>12}{:>12}{:>16}\n", "phase", "wall, s", "cpu, s", "peak RSS, MiB");
+    for (const auto& phase : phases_) {
+        table += uxs::format("{:<32}{:>12.3f}{:>12.3f}{:>16.1f}\n", phase.name, phase.wall_time, phase.cpu_time,
+                             phase.peak_rss / (1024. * 1024.));
+    }
+    table += uxs::format("\n{:<32}{:>12}\n", "counter", "value");
+    for (const auto& [name, value] : counters_) { table += uxs::format("{:<32}{:>12}\n", name, value); }
+    return table;
+}
+
+std::string TimeReport::makeJson() const {
+    std::string json = "{\n  \"phases\": [";
+    for (std::size_t n = 0; n < phases_.size(); ++n) {
+        const auto& phase = phases_[n];
+        json += uxs::format(
+            "{}\n    {{\"name\": \"{}\", \"wall_time\": {:.6f}, \"cpu_time\": {:.6f}, \"peak_rss\": {}}}",
+            n > 0 ? "," : "", phase.name, phase.wall_time, phase.cpu_time, phase.peak_rss);
+    }
+    json += "\n  ],\n  \"counters\": {";
+    for (std::size_t n = 0; n < counters_.size(); ++n) {
+        json += uxs::format("{}\n    \"{}\": {}", n > 0 ? "," : "", counters_[n].first, counters_[n].second);
+    }
+    json += "\n  }\n}\n";
+    return json;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Generator performance report: wall time, CPU time and peak RSS of phases together with hot counters
+class TimeReport {
+ public:
+    // Measures a phase from construction or `next()` call till destruction, `finish()` or `next()` call; does
+    // nothing if the report is null; time of phases with the same name is summed
+    class Phase {
+     public:
+        Phase(TimeReport* report, std::string_view name) : report_(report) { start(name); }
+        ~Phase() { finish(); }
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+        void next(std::string_view name) {
+            finish();
+            start(name);
+        }
+        void finish();
+
+     private:
+        TimeReport* report_;
+        bool running_ = false;
+        std::string_view name_;
+        std::chrono::steady_clock::time_point wall_start_;
+        double cpu_start_ = 0;
+
+        void start(std::string_view name);
+    };
+
+    void addCounter(std::string_view name, std::uint64_t value);
+    std::string makeTable() const;
+    std::string makeJson() const;
+
+ private:
+    struct PhaseInfo {
+        std::string name;
+        double wall_time = 0;      // In seconds
+        double cpu_time = 0;       // In seconds, counting all threads
+        std::size_t peak_rss = 0;  // In bytes, for the whole process till the end of the phase
+    };
+
+    std::vector<PhaseInfo> phases_;
+    std::vector<std::pair<std::string, std::uint64_t>> counters_;
+};
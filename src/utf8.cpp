@@ -0,0 +1,132 @@
+#include "utf8.h"
+
+#include <array>
+#include <unordered_map>
+
+unsigned encodeUtf8(unsigned code, char* out) {
+    if (code < 0x80) {
+        out[0] = static_cast<char>(code);
+        return 1;
+    }
+    const unsigned count = code < 0x800 ? 2 : (code < 0x10000 ? 3 : 4);
+    for (unsigned n = count - 1; n > 0; --n, code >>= 6) { out[n] = static_cast<char>(0x80 | (code & 0x3f)); }
+    out[0] = static_cast<char>(((0xff00 >> count) & 0xff) | code);
+    return count;
+}
+
+namespace {
+using ByteRange = std::pair<unsigned, unsigned>;
+
+// Splits code point range into subranges, which encodings are sequences of independent byte ranges, e.g.
+// [U+0400, U+04FF] -> [D0-D3][80-BF]
+void splitCodePointRange(unsigned lo, unsigned hi, std::vector<std::vector<ByteRange>>& seqs) {
+    for (unsigned max : {0x7fu, 0x7ffu, 0xffffu}) {  // Split by encoding length
+        if (lo <= max && hi > max) {
+            splitCodePointRange(lo, max, seqs);
+            splitCodePointRange(max + 1, hi, seqs);
+            return;
+        }
+    }
+    for (unsigned n = 1; n < 4; ++n) {  // Split by continuation byte boundaries
+        const unsigned mask = (1u << (6 * n)) - 1;
+        if ((lo & ~mask) == (hi & ~mask)) { continue; }
+        if ((lo & mask) != 0) {
+            splitCodePointRange(lo, lo | mask, seqs);
+            splitCodePointRange((lo | mask) + 1, hi, seqs);
+            return;
+        }
+        if ((hi & mask) != mask) {
+            splitCodePointRange(lo, (hi & ~mask) - 1, seqs);
+            splitCodePointRange(hi & ~mask, hi, seqs);
+            return;
+        }
+    }
+    std::array<char, 4> lo_bytes{}, hi_bytes{};
+    const unsigned count = encodeUtf8(lo, lo_bytes.data());
+    encodeUtf8(hi, hi_bytes.data());
+    auto& seq = seqs.emplace_back(count);
+    for (unsigned n = 0; n < count; ++n) {
+        seq[n] = {static_cast<unsigned char>(lo_bytes[n]), static_cast<unsigned char>(hi_bytes[n])};
+    }
+}
+
+// Prefix tree of byte range sequences: an edge leads to the next byte node or has -1 index for the last byte
+struct TrieNode {
+    std::vector<std::pair<ByteRange, int>> edges;
+};
+
+// Subtree key: the suffix of each byte, equal subtrees are made only once, so suffixes are compared by pointers
+using SubtreeKey = std::vector<std::pair<unsigned, const Node*>>;
+
+struct SubtreeKeyHash {
+    std::size_t operator()(const SubtreeKey& key) const {
+        std::size_t h = 0;
+        for (const auto& [byte, suffix] : key) {
+            h ^= std::hash<const Node*>{}(suffix) + byte + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+const Node* makeTrieSubtree(NodePool& pool, const std::vector<TrieNode>& trie, int n_node,
+                            std::unordered_map<SubtreeKey, const Node*, SubtreeKeyHash>& subtrees) {
+    // Edges with equal suffixes are merged into one byte set
+    std::vector<std::pair<ValueSet, const Node*>> groups;
+    for (const auto& [range, child] : trie[n_node].edges) {
+        const Node* suffix = child >= 0 ? makeTrieSubtree(pool, trie, child, subtrees) : nullptr;
+        auto it = std::find_if(groups.begin(), groups.end(), [suffix](const auto& g) { return g.second == suffix; });
+        if (it == groups.end()) { it = groups.emplace(groups.end(), ValueSet(), suffix); }
+        it->first.addValues(range.first, range.second);
+    }
+
+    SubtreeKey key;
+    for (const auto& [bytes, suffix] : groups) {
+        for (unsigned byte : bytes) { key.emplace_back(byte, suffix); }
+    }
+    auto [it, inserted] = subtrees.emplace(std::move(key), nullptr);
+    if (!inserted) { return it->second; }
+
+    const Node* node = nullptr;
+    for (const auto& [bytes, suffix] : groups) {
+        const Node* term = pool.newSymbSetNode(bytes);
+        if (suffix) { term = pool.newNode(NodeType::kCat, term, suffix); }
+        node = node ? pool.newNode(NodeType::kOr, node, term) : term;
+    }
+    return it->second = node;
+}
+}  // namespace
+
+const Node* makeUtf8Node(NodePool& pool, const ValueSet& code_points) {
+    std::vector<std::vector<ByteRange>> seqs;
+    unsigned lo = 0, hi = 0;
+    bool has_range = false;
+    for (unsigned code : code_points) {
+        if (code > kMaxCodePoint || (code >= kSurrogateFirst && code <= kSurrogateLast)) { continue; }
+        if (has_range && code == hi + 1) {
+            hi = code;
+            continue;
+        }
+        if (has_range) { splitCodePointRange(lo, hi, seqs); }
+        lo = hi = code, has_range = true;
+    }
+    if (!has_range) { return pool.newSymbSetNode(ValueSet()); }
+    splitCodePointRange(lo, hi, seqs);
+
+    // Sequences are sorted and do not overlap, so equal prefixes can be only at the back of the edge list
+    std::vector<TrieNode> trie(1);
+    for (const auto& seq : seqs) {
+        int n_node = 0;
+        for (std::size_t n = 0; n + 1 < seq.size(); ++n) {
+            auto& edges = trie[n_node].edges;
+            if (edges.empty() || edges.back().first != seq[n]) {
+                edges.emplace_back(seq[n], static_cast<int>(trie.size()));
+                trie.emplace_back();  // Note: invalidates `edges`
+            }
+            n_node = trie[n_node].edges.back().second;
+        }
+        trie[n_node].edges.emplace_back(seq.back(), -1);
+    }
+
+    std::unordered_map<SubtreeKey, const Node*, SubtreeKeyHash> subtrees;
+    return makeTrieSubtree(pool, trie, 0, subtrees);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "node.h"
+
+const unsigned kMaxCodePoint = 0x10ffff;
+const unsigned kSurrogateFirst = 0xd800;
+const unsigned kSurrogateLast = 0xdfff;
+
+// Writes UTF-8 encoding of `code` to `out`, returns the byte count
+unsigned encodeUtf8(unsigned code, char* out);
+
+// Makes a syntax tree, which matches UTF-8 encoded code points from `code_points`: code point ranges are split into
+// byte range sequences, the sequences are merged by common prefixes, and equal suffixes are shared
+const Node* makeUtf8Node(NodePool& pool, const ValueSet& code_points);
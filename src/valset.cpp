@@ -1,80 +1,132 @@
 #include "valset.h"
 
-#include <algorithm>
-
-bool ValueSet::empty() const {
-    return std::all_of(set_.begin(), set_.end(), [](const auto& w) { return w == 0; });
-}
-
-unsigned ValueSet::getFirstValue() const {
-    unsigned v = 0;
-    for (const auto& w : set_) {
-        if (w) { return v + detail::lsb(w); }
-        v += kBitsPerWord;
+std::size_t ValueSet::hash() const {
+    std::size_t h = 0;
+    for (const auto& w : words_) {
+        h ^= std::hash<unsigned>{}(w.index) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned long>{}(w.bits) + 0x9e3779b9 + (h << 6) + (h >> 2);
     }
-    return v;
+    return h;
 }
 
-unsigned ValueSet::getNextValue(unsigned v) const {
-    assert(v <= kMaxValue);
-    auto it = set_.begin() + nword(v++);
-    if (unsigned n = nbit(v); n && (*it >> n)) {
-        v += detail::lsb(*it >> n);
+ValueSet& ValueSet::addBits(unsigned index, unsigned long bits) {
+    if (words_.empty() || words_.back().index < index) {
+        words_.push_back(Word{index, bits});
+        return *this;
+    }
+    auto it = words_.begin() + (findWord(index) - words_.begin());
+    if (it->index == index) {
+        it->bits |= bits;
     } else {
-        v = detail::alignUp(v, kBitsPerWord);
-        for (++it; it != set_.end(); ++it, v += kBitsPerWord) {
-            if (*it) { return v + detail::lsb(*it); }
-        }
+        words_.insert(it, Word{index, bits});
     }
-    return v;
+    return *this;
 }
 
 ValueSet& ValueSet::addValues(unsigned from, unsigned to) {
-    assert(from <= to && to <= kMaxValue);
-    auto it = set_.begin() + nword(from), it_last = set_.begin() + nword(++to);
-    if (it == it_last) {
-        *it |= ~(bitmask(from) - 1) & (bitmask(to) - 1);
-    } else {
-        *it++ |= ~(bitmask(from) - 1);
-        while (it != it_last) { *it++ = ~0ul; }
-        if (it_last != set_.end()) { *it_last |= bitmask(to) - 1; }
-    }
+    assert(from <= to);
+    for (unsigned n = nword(from); n <= nword(to); ++n) { addBits(n, rangemask(n, from, to)); }
+    return *this;
+}
+
+ValueSet& ValueSet::removeValue(unsigned v) {
+    auto it = words_.begin() + (findWord(nword(v)) - words_.begin());
+    if (it != words_.end() && it->index == nword(v) && !(it->bits &= ~bitmask(v))) { words_.erase(it); }
     return *this;
 }
 
 ValueSet& ValueSet::removeValues(unsigned from, unsigned to) {
-    assert(from <= to && to <= kMaxValue);
-    auto it = set_.begin() + nword(from), it_last = set_.begin() + nword(++to);
-    if (it == it_last) {
-        *it &= (bitmask(from) - 1) | ~(bitmask(to) - 1);
-    } else {
-        *it++ &= bitmask(from) - 1;
-        while (it != it_last) { *it++ = 0ul; }
-        if (it_last != set_.end()) { *it_last &= ~(bitmask(to) - 1); }
+    assert(from <= to);
+    auto first = words_.begin() + (findWord(nword(from)) - words_.begin()), last = first;
+    for (; last != words_.end() && last->index <= nword(to); ++last) {
+        last->bits &= ~rangemask(last->index, from, to);
     }
+    words_.erase(std::remove_if(first, last, [](const Word& w) { return !w.bits; }), last);
     return *this;
 }
 
 ValueSet& ValueSet::operator|=(const ValueSet& rhs) {
-    std::transform(set_.begin(), set_.end(), rhs.set_.begin(), set_.begin(),
-                   [](const auto& w1, const auto& w2) { return w1 | w2; });
+    if (rhs.words_.empty()) { return *this; }
+    if (words_.empty() || words_.back().index < rhs.words_.front().index) {
+        words_.insert(words_.end(), rhs.words_.begin(), rhs.words_.end());
+        return *this;
+    }
+
+    // Calculate the resulting word count and merge words in place starting from the back
+    std::size_t count = words_.size() + rhs.words_.size();
+    for (auto it = words_.cbegin(), it2 = rhs.words_.begin(); it != words_.cend() && it2 != rhs.words_.end();) {
+        if (it->index < it2->index) {
+            ++it;
+        } else if (it2->index < it->index) {
+            ++it2;
+        } else {
+            --count, ++it, ++it2;
+        }
+    }
+
+    std::size_t n = words_.size(), n2 = rhs.words_.size();
+    words_.resize(count);
+    while (n2 > 0) {
+        const Word& w2 = rhs.words_[n2 - 1];
+        if (n > 0 && words_[n - 1].index > w2.index) {
+            words_[--count] = words_[--n];
+        } else if (n > 0 && words_[n - 1].index == w2.index) {
+            words_[--count] = Word{w2.index, words_[--n].bits | w2.bits};
+            --n2;
+        } else {
+            words_[--count] = w2;
+            --n2;
+        }
+    }
     return *this;
 }
 
 ValueSet& ValueSet::operator&=(const ValueSet& rhs) {
-    std::transform(set_.begin(), set_.end(), rhs.set_.begin(), set_.begin(),
-                   [](const auto& w1, const auto& w2) { return w1 & w2; });
+    auto out = words_.begin();
+    auto it2 = rhs.words_.begin();
+    for (auto it = words_.begin(); it != words_.end() && it2 != rhs.words_.end();) {
+        if (it->index < it2->index) {
+            ++it;
+        } else if (it2->index < it->index) {
+            ++it2;
+        } else {
+            if (unsigned long bits = it->bits & it2->bits; bits) { *out++ = Word{it->index, bits}; }
+            ++it, ++it2;
+        }
+    }
+    words_.erase(out, words_.end());
     return *this;
 }
 
 ValueSet& ValueSet::operator^=(const ValueSet& rhs) {
-    std::transform(set_.begin(), set_.end(), rhs.set_.begin(), set_.begin(),
-                   [](const auto& w1, const auto& w2) { return w1 ^ w2; });
+    std::vector<Word> words;
+    words.reserve(words_.size() + rhs.words_.size());
+    auto it = words_.cbegin(), it2 = rhs.words_.begin();
+    while (it != words_.cend() && it2 != rhs.words_.end()) {
+        if (it->index < it2->index) {
+            words.push_back(*it++);
+        } else if (it2->index < it->index) {
+            words.push_back(*it2++);
+        } else {
+            if (unsigned long bits = it->bits ^ it2->bits; bits) { words.push_back(Word{it->index, bits}); }
+            ++it, ++it2;
+        }
+    }
+    words.insert(words.end(), it, words_.cend());
+    words.insert(words.end(), it2, rhs.words_.end());
+    words_.swap(words);
     return *this;
 }
 
 ValueSet& ValueSet::operator-=(const ValueSet& rhs) {
-    std::transform(set_.begin(), set_.end(), rhs.set_.begin(), set_.begin(),
-                   [](const auto& w1, const auto& w2) { return w1 & ~w2; });
+    auto out = words_.begin();
+    auto it2 = rhs.words_.begin();
+    for (auto it = words_.begin(); it != words_.end(); ++it) {
+        while (it2 != rhs.words_.end() && it2->index < it->index) { ++it2; }
+        unsigned long bits = it->bits;
+        if (it2 != rhs.words_.end() && it2->index == it->index) { bits &= ~it2->bits; }
+        if (bits) { *out++ = Word{it->index, bits}; }
+    }
+    words_.erase(out, words_.end());
     return *this;
 }
@@ -1,29 +1,20 @@
 #pragma once
 
-#include <array>
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstddef>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <vector>
 
-namespace detail {
-constexpr unsigned lsb(unsigned long v) {
-    unsigned r = 0;
-    while (!(v & 1)) { v >>= 1, ++r; }
-    return r;
-}
-constexpr unsigned alignUp(unsigned v, unsigned base) { return (v + base - 1) & ~(base - 1); }
-}  // namespace detail
-
+// Set of unsigned values: a sparse bit array, which stores only nonzero words together with their indices, so
+// small sets stay small regardless of value magnitudes
 class ValueSet {
  public:
-    ValueSet() { set_.fill(0); }
-    ValueSet(unsigned from, unsigned to) {
-        set_.fill(0);
-        addValues(from, to);
-    }
-
-    static const unsigned kMaxValue = 1023;
+    ValueSet() = default;
+    ValueSet(unsigned from, unsigned to) { addValues(from, to); }
 
     class Iterator {
      public:
@@ -36,7 +27,10 @@ class ValueSet {
         Iterator() = default;
 
         Iterator& operator++() {
-            v_ = vset_->getNextValue(v_);
+            const auto& words = vset_->words_;
+            unsigned long bits = words[n_].bits & ~lowmask(v_);
+            if (!bits && ++n_ < words.size()) { bits = words[n_].bits; }
+            v_ = bits ? (words[n_].index << kBit2WordShift) + std::countr_zero(bits) : 0;
             return *this;
         }
         reference operator*() const { return v_; }
@@ -50,42 +44,37 @@ class ValueSet {
 
         friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
             assert(lhs.vset_ == rhs.vset_);
-            return lhs.v_ == rhs.v_;
+            return lhs.n_ == rhs.n_ && lhs.v_ == rhs.v_;
         }
         friend bool operator!=(const Iterator& lhs, const Iterator& rhs) { return !(lhs == rhs); }
 
      private:
         const ValueSet* vset_ = nullptr;
+        std::size_t n_ = 0;
         unsigned v_ = 0;
         friend class ValueSet;
-        Iterator(const ValueSet* vset, unsigned v) : vset_(vset), v_(v) {}
+        Iterator(const ValueSet* vset, std::size_t n, unsigned v) : vset_(vset), n_(n), v_(v) {}
     };
 
-    bool empty() const;
-    Iterator begin() const { return Iterator(this, getFirstValue()); }
-    Iterator end() const { return Iterator(this, kMaxValue + 1); }
-    unsigned getFirstValue() const;
-    unsigned getNextValue(unsigned v) const;
+    bool empty() const { return words_.empty(); }
+    std::size_t hash() const;
+    Iterator begin() const {
+        if (words_.empty()) { return end(); }
+        return Iterator(this, 0, (words_[0].index << kBit2WordShift) + std::countr_zero(words_[0].bits));
+    }
+    Iterator end() const { return Iterator(this, words_.size(), 0); }
     bool contains(unsigned v) const {
-        assert(v <= kMaxValue);
-        return set_[nword(v)] & bitmask(v);
+        auto it = findWord(nword(v));
+        return it != words_.end() && it->index == nword(v) && (it->bits & bitmask(v));
     }
 
     ValueSet& clear() {
-        set_.fill(0);
-        return *this;
-    }
-    ValueSet& addValue(unsigned v) {
-        assert(v <= kMaxValue);
-        set_[nword(v)] |= bitmask(v);
+        words_.clear();
         return *this;
     }
+    ValueSet& addValue(unsigned v) { return addBits(nword(v), bitmask(v)); }
     ValueSet& addValues(unsigned from, unsigned to);
-    ValueSet& removeValue(unsigned v) {
-        assert(v <= kMaxValue);
-        set_[nword(v)] &= ~bitmask(v);
-        return *this;
-    }
+    ValueSet& removeValue(unsigned v);
     ValueSet& removeValues(unsigned from, unsigned to);
 
     ValueSet& operator|=(const ValueSet& rhs);
@@ -109,16 +98,39 @@ class ValueSet {
         ValueSet ret = lhs;
         return ret -= rhs;
     }
-    friend bool operator==(const ValueSet& lhs, const ValueSet& rhs) { return lhs.set_ == rhs.set_; }
-    friend bool operator!=(const ValueSet& lhs, const ValueSet& rhs) { return lhs.set_ != rhs.set_; }
+    friend bool operator==(const ValueSet& lhs, const ValueSet& rhs) { return lhs.words_ == rhs.words_; }
+    friend bool operator!=(const ValueSet& lhs, const ValueSet& rhs) { return lhs.words_ != rhs.words_; }
 
  protected:
     static constexpr unsigned kBitsPerWord = 8 * sizeof(unsigned long);
-    static constexpr unsigned kBit2WordShift = detail::lsb(kBitsPerWord);
+    static constexpr unsigned kBit2WordShift = std::countr_zero(kBitsPerWord);
     static unsigned nword(unsigned v) { return v >> kBit2WordShift; }
     static unsigned nbit(unsigned v) { return v & (kBitsPerWord - 1); }
     static unsigned long bitmask(unsigned v) { return 1ul << nbit(v); }
+    static unsigned long lowmask(unsigned v) { return ~0ul >> (kBitsPerWord - 1 - nbit(v)); }
+    static unsigned long rangemask(unsigned n, unsigned from, unsigned to) {
+        return (n == nword(from) ? ~(bitmask(from) - 1) : ~0ul) & (n == nword(to) ? lowmask(to) : ~0ul);
+    }
+
+    struct Word {
+        unsigned index;
+        unsigned long bits;
+        friend bool operator==(const Word& lhs, const Word& rhs) {
+            return lhs.index == rhs.index && lhs.bits == rhs.bits;
+        }
+    };
+
+    // Nonzero words of the bit array in ascending order of indices
+    std::vector<Word> words_;
+
+    std::vector<Word>::const_iterator findWord(unsigned index) const {
+        return std::lower_bound(words_.begin(), words_.end(), index,
+                                [](const Word& w, unsigned index) { return w.index < index; });
+    }
+    ValueSet& addBits(unsigned index, unsigned long bits);
+};
 
-    // Bit array for presence indication
-    std::array<unsigned long, (kMaxValue + 1) / kBitsPerWord> set_;
+template<>
+struct std::hash<ValueSet> {
+    std::size_t operator()(const ValueSet& vset) const noexcept { return vset.hash(); }
 };